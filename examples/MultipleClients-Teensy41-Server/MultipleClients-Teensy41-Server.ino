@@ -101,11 +101,13 @@ void listenForClients() {
     int8_t freeIndex = getFreeClientIndex();
     if (freeIndex >= 0) {
       WebsocketsClient newClient = server.accept();
+      // the request may not have fully arrived yet, it is picked up by a later poll
+      if (!newClient.available()) return;
       Serial.printf("Accepted new websockets client at index %d\n", freeIndex);
       newClient.onMessage(handleMessage);
       newClient.onEvent(handleEvent);
       newClient.send("Hello from Teensy");
-      clients[freeIndex] = newClient;
+      clients[freeIndex] = std::move(newClient);
     }
   }
 }
@@ -108,11 +108,13 @@ void listenForSocketClients() {
     int8_t freeIndex = getFreeSocketClientIndex();
     if (freeIndex >= 0) {
       WebsocketsClient newClient = socketServer.accept();
+      // the request may not have fully arrived yet, it is picked up by a later poll
+      if (!newClient.available()) return;
       Serial.printf("Accepted new websockets client at index %d\n", freeIndex);
       newClient.onMessage(handleMessage);
       newClient.onEvent(handleEvent);
       newClient.send("Hello from Teensy");
-      socketClients[freeIndex] = newClient;
+      socketClients[freeIndex] = std::move(newClient);
     }
   }
 }
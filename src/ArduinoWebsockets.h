@@ -4,5 +4,6 @@
 #include "tiny_websockets/message.hpp"
 #include "tiny_websockets/client.hpp"
 #include "tiny_websockets/server.hpp"
+#include "tiny_websockets/static_client.hpp"
 
 #endif //_WEBSOCKETS_CLIENT_H
\ No newline at end of file
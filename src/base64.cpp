@@ -0,0 +1,261 @@
+#include <tiny_websockets/internals/wscrypto/base64.hpp>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  #define _WS_BASE64_SSSE3
+  #include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  #define _WS_BASE64_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace websockets { namespace crypto { namespace internals {
+  static const char ENCODE_TABLE[64 + 1] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+  #define NA 0xff
+  // value of every base64 char, 0xff for everything else (including the padding)
+  static const uint8_t DECODE_TABLE[256] = {
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, 62, NA, NA, NA, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, NA, NA, NA, NA, NA, NA,
+    NA,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, NA, NA, NA, NA, NA,
+    NA, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+    NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA, NA,
+  };
+  #undef NA
+
+#ifdef _WS_BASE64_SSSE3
+  #define SSSE3_TARGET __attribute__((target("ssse3")))
+
+  // 12 bytes in, 16 chars out per step (reads 16 bytes, so at least 16 must be left)
+  SSSE3_TARGET
+  static size_t encodeSsse3(const uint8_t* bytes, size_t len, char* out) {
+    size_t done = 0;
+    for(; len - done >= 16; done += 12, out += 16) {
+      __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + done));
+      // every 32 bit lane gets the 3 bytes of one group, as [b1 b0 b2 b1]
+      in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+      // move each 6 bit index into its own byte
+      const __m128i first = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+      const __m128i second = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+      const __m128i indices = _mm_or_si128(first, second);
+
+      // the offset from index to ascii only depends on the range the index is in
+      __m128i ranges = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+      const __m128i lowercase = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+      ranges = _mm_or_si128(ranges, _mm_and_si128(lowercase, _mm_set1_epi8(13)));
+      const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+      );
+      const __m128i chars = _mm_add_epi8(_mm_shuffle_epi8(offsets, ranges), indices);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+    }
+    return done;
+  }
+
+  // 16 chars in, 12 bytes out per step (writes 16 bytes, so at least 24 chars must be left).
+  // Stops before the first block with a padding or invalid char, the scalar code handles that one
+  SSSE3_TARGET
+  static size_t decodeSsse3(const char* encoded, size_t len, uint8_t* out) {
+    const __m128i lowNibbleClasses = _mm_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a
+    );
+    const __m128i highNibbleClasses = _mm_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+    );
+    const __m128i offsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i slash = _mm_set1_epi8(0x2f);
+
+    size_t done = 0;
+    for(; len - done >= 24; done += 16, out += 12) {
+      const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(encoded + done));
+      const __m128i highNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), slash);
+      const __m128i lowNibbles = _mm_and_si128(in, slash);
+
+      // a char is invalid when the classes of its two nibbles intersect
+      const __m128i invalid = _mm_and_si128(
+        _mm_shuffle_epi8(lowNibbleClasses, lowNibbles),
+        _mm_shuffle_epi8(highNibbleClasses, highNibbles)
+      );
+      if(_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xffff) break;
+
+      const __m128i isSlash = _mm_cmpeq_epi8(in, slash);
+      const __m128i values = _mm_add_epi8(in, _mm_shuffle_epi8(offsets, _mm_add_epi8(isSlash, highNibbles)));
+
+      // pack the 6 bit values: 4 x 6 -> 2 x 12 -> 1 x 24 bits per lane, then drop the empty bytes
+      const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+      const __m128i triples = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+      const __m128i bytes = _mm_shuffle_epi8(triples, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+    }
+    return done;
+  }
+
+  #undef SSSE3_TARGET
+
+  static bool hasSsse3() {
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+  }
+#endif // _WS_BASE64_SSSE3
+
+#ifdef _WS_BASE64_NEON
+  // 48 bytes in, 64 chars out per step
+  static size_t encodeNeon(const uint8_t* bytes, size_t len, char* out) {
+    const uint8_t* table = reinterpret_cast<const uint8_t*>(ENCODE_TABLE);
+    uint8x16x4_t lookup;
+    for(int i = 0; i < 4; i++) lookup.val[i] = vld1q_u8(table + i * 16);
+    const uint8x16_t sixBits = vdupq_n_u8(0x3f);
+
+    size_t done = 0;
+    for(; len - done >= 48; done += 48, out += 64) {
+      const uint8x16x3_t in = vld3q_u8(bytes + done);
+      uint8x16x4_t chars;
+      chars.val[0] = vshrq_n_u8(in.val[0], 2);
+      chars.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)), sixBits);
+      chars.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)), sixBits);
+      chars.val[3] = vandq_u8(in.val[2], sixBits);
+      for(int i = 0; i < 4; i++) chars.val[i] = vqtbl4q_u8(lookup, chars.val[i]);
+      vst4q_u8(reinterpret_cast<uint8_t*>(out), chars);
+    }
+    return done;
+  }
+
+  // 64 chars in, 48 bytes out per step. Stops before the first block with a padding or invalid char
+  static size_t decodeNeon(const char* encoded, size_t len, uint8_t* out) {
+    uint8x16x4_t lowChars, highChars;
+    for(int i = 0; i < 4; i++) {
+      lowChars.val[i] = vld1q_u8(DECODE_TABLE + i * 16);
+      highChars.val[i] = vld1q_u8(DECODE_TABLE + 64 + i * 16);
+    }
+
+    size_t done = 0;
+    for(; len - done >= 64; done += 64, out += 48) {
+      const uint8x16x4_t in = vld4q_u8(reinterpret_cast<const uint8_t*>(encoded + done));
+      uint8x16x4_t values;
+      uint8x16_t any = vdupq_n_u8(0);
+      for(int i = 0; i < 4; i++) {
+        // chars 0-63 come from the first lookup, 64-127 from the second, anything above is invalid
+        uint8x16_t value = vqtbl4q_u8(lowChars, in.val[i]);
+        value = vqtbx4q_u8(value, highChars, vsubq_u8(in.val[i], vdupq_n_u8(64)));
+        values.val[i] = vorrq_u8(value, vcgeq_u8(in.val[i], vdupq_n_u8(128)));
+        any = vorrq_u8(any, values.val[i]);
+      }
+      if(vmaxvq_u8(any) > 63) break;
+
+      uint8x16x3_t bytes;
+      bytes.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+      bytes.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+      bytes.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+      vst3q_u8(out, bytes);
+    }
+    return done;
+  }
+#endif // _WS_BASE64_NEON
+
+  size_t base64_encode(const uint8_t* bytes, size_t len, char* out) {
+    char* const begin = out;
+    size_t done = 0;
+#if defined(_WS_BASE64_SSSE3)
+    if(hasSsse3()) {
+      done = encodeSsse3(bytes, len, out);
+      out += done / 3 * 4;
+    }
+#elif defined(_WS_BASE64_NEON)
+    done = encodeNeon(bytes, len, out);
+    out += done / 3 * 4;
+#endif
+
+    for(; len - done >= 3; done += 3) {
+      const uint32_t group = (bytes[done] << 16) | (bytes[done + 1] << 8) | bytes[done + 2];
+      *out++ = ENCODE_TABLE[(group >> 18) & 0x3f];
+      *out++ = ENCODE_TABLE[(group >> 12) & 0x3f];
+      *out++ = ENCODE_TABLE[(group >> 6) & 0x3f];
+      *out++ = ENCODE_TABLE[group & 0x3f];
+    }
+
+    if(len - done == 1) {
+      const uint32_t group = bytes[done] << 16;
+      *out++ = ENCODE_TABLE[(group >> 18) & 0x3f];
+      *out++ = ENCODE_TABLE[(group >> 12) & 0x3f];
+      *out++ = '=';
+      *out++ = '=';
+    } else if(len - done == 2) {
+      const uint32_t group = (bytes[done] << 16) | (bytes[done + 1] << 8);
+      *out++ = ENCODE_TABLE[(group >> 18) & 0x3f];
+      *out++ = ENCODE_TABLE[(group >> 12) & 0x3f];
+      *out++ = ENCODE_TABLE[(group >> 6) & 0x3f];
+      *out++ = '=';
+    }
+
+    return out - begin;
+  }
+
+  size_t base64_decode(const char* encoded, size_t len, uint8_t* out) {
+    const uint8_t* input = reinterpret_cast<const uint8_t*>(encoded);
+    uint8_t* const begin = out;
+    size_t done = 0;
+#if defined(_WS_BASE64_SSSE3)
+    if(hasSsse3()) {
+      done = decodeSsse3(encoded, len, out);
+      out += done / 4 * 3;
+    }
+#elif defined(_WS_BASE64_NEON)
+    done = decodeNeon(encoded, len, out);
+    out += done / 4 * 3;
+#endif
+
+    for(; len - done >= 4; done += 4) {
+      const uint8_t a = DECODE_TABLE[input[done]];
+      const uint8_t b = DECODE_TABLE[input[done + 1]];
+      const uint8_t c = DECODE_TABLE[input[done + 2]];
+      const uint8_t d = DECODE_TABLE[input[done + 3]];
+      // padding or garbage, the tail code decodes whatever came before it
+      if((a | b | c | d) & 0xc0) break;
+
+      const uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+      *out++ = static_cast<uint8_t>(group >> 16);
+      *out++ = static_cast<uint8_t>(group >> 8);
+      *out++ = static_cast<uint8_t>(group);
+    }
+
+    // up to 3 valid chars are left, they hold one byte less than their count
+    uint32_t group = 0;
+    size_t count = 0;
+    for(; done < len && count < 4; done++, count++) {
+      const uint8_t value = DECODE_TABLE[input[done]];
+      if(value & 0xc0) break;
+      group |= static_cast<uint32_t>(value) << (18 - count * 6);
+    }
+    if(count >= 2) *out++ = static_cast<uint8_t>(group >> 16);
+    if(count >= 3) *out++ = static_cast<uint8_t>(group >> 8);
+
+    return out - begin;
+  }
+
+  WSString base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
+    WSString result(base64_encoded_size(in_len), '\0');
+    result.resize(base64_encode(bytes_to_encode, in_len, &result[0]));
+    return result;
+  }
+
+  WSString base64_decode(WSString const& encoded_string) {
+    WSString result(base64_decoded_max_size(encoded_string.size()), '\0');
+    result.resize(base64_decode(encoded_string.data(), encoded_string.size(), reinterpret_cast<uint8_t*>(&result[0])));
+    return result;
+  }
+}}} // websockets::crypto::internals
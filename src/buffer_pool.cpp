@@ -0,0 +1,49 @@
+#include <tiny_websockets/internals/buffer_pool.hpp>
+
+namespace websockets { namespace internals {
+    WSString BufferPool::take(const size_t capacity) {
+        WSString buffer;
+#if _WS_BUFFER_POOL_SLOTS > 0
+        // the smallest cached buffer that is large enough
+        WSString* best = nullptr;
+        for(size_t i = 0; this->_buffers && i < _WS_BUFFER_POOL_SLOTS; i++) {
+            WSString& cached = this->_buffers[i];
+            if(cached.capacity() >= capacity && (best == nullptr || cached.capacity() < best->capacity())) {
+                best = &cached;
+            }
+        }
+        if(best != nullptr) {
+            buffer.swap(*best);
+            buffer.clear();
+            return buffer;
+        }
+#endif
+        buffer.reserve(capacity);
+        return buffer;
+    }
+
+    void BufferPool::give(WSString&& buffer) {
+#if _WS_BUFFER_POOL_SLOTS > 0
+        // short strings live inside the string object, there is nothing to keep
+        static const size_t inlineCapacity = WSString().capacity();
+        if(buffer.capacity() <= inlineCapacity || buffer.capacity() > _WS_BUFFER_POOL_MAX_SIZE) return;
+
+        if(!this->_buffers) this->_buffers.reset(new WSString[_WS_BUFFER_POOL_SLOTS]);
+
+        // an empty slot, or else the smallest buffer if this one is larger
+        WSString* slot = &this->_buffers[0];
+        for(size_t i = 1; i < _WS_BUFFER_POOL_SLOTS; i++) {
+            if(this->_buffers[i].capacity() < slot->capacity()) slot = &this->_buffers[i];
+        }
+        if(slot->capacity() < buffer.capacity()) slot->swap(buffer);
+#else
+        (void) buffer;
+#endif
+    }
+
+    void BufferPool::clear() {
+#if _WS_BUFFER_POOL_SLOTS > 0
+        this->_buffers.reset();
+#endif
+    }
+}} // websockets::internals
@@ -2,10 +2,21 @@
 #include <tiny_websockets/internals/wscrypto/base64.hpp>
 #include <tiny_websockets/internals/wscrypto/sha1.hpp>
 
-#ifndef _WS_CONFIG_NO_TRUE_RANDOMNESS
+#ifdef __linux__
+#include <sys/random.h>
+#include <errno.h>
+#include <stdio.h>
+#include <pthread.h>
+#elif defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#elif !defined(ARDUINO)
 #include <time.h>
 #endif
 
+#ifndef ARDUINO
+#include <mutex>
+#endif
+
 namespace websockets { namespace crypto {
   WSString base64Encode(WSString data) {
     return internals::base64_encode(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
@@ -18,41 +29,255 @@ namespace websockets { namespace crypto {
     return internals::base64_decode(data);
   }
 
+  size_t base64Encode(const uint8_t* data, size_t len, char* out) {
+    return internals::base64_encode(data, len, out);
+  }
+
+  size_t base64Decode(const char* data, size_t len, uint8_t* out) {
+    return internals::base64_decode(data, len, out);
+  }
+
   WSString websocketsHandshakeEncodeKey(WSString key) {
-      char base64[30];
-      internals::sha1(key.c_str())
-        .add("258EAFA5-E914-47DA-95CA-C5AB0DC85B11")
+      return websocketsHandshakeEncodeKey(key.c_str(), key.size());
+  }
+
+  static const char HANDSHAKE_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+  void websocketsHandshakeEncodeKey(const char* key, size_t len, char accept[SHA1_BASE64_SIZE]) {
+      internals::sha1()
+        .add(key, len)
+        .add(HANDSHAKE_GUID)
         .finalize()
-        .print_base64(base64);
-      
+        .print_base64(accept);
+  }
+
+  WSString websocketsHandshakeEncodeKey(const char* key, size_t len) {
+      char base64[SHA1_BASE64_SIZE];
+      websocketsHandshakeEncodeKey(key, len, base64);
       return WSString(base64);
   }
 
-#ifdef _WS_CONFIG_NO_TRUE_RANDOMNESS
-  WSString randomBytes(size_t len) {
-    WSString result;
-    result.reserve(len);
+  // room for the padded message of a key of up to 83 bytes (valid keys are always 24)
+  #define HANDSHAKE_MESSAGE_SIZE 128
+
+  // Writes key + guid with the sha1 padding into `message`, returns the number of blocks
+  // (0 if the key is too long for the buffer)
+  static size_t padHandshakeMessage(const char* key, size_t len, uint8_t* message) {
+      const size_t messageLen = len + sizeof(HANDSHAKE_GUID) - 1;
+      // 0x80 and the 64 bit length always follow the message
+      const size_t blocks = (messageLen + 1 + 8 + 63) / 64;
+      if(blocks * 64 > HANDSHAKE_MESSAGE_SIZE) return 0;
+
+      memcpy(message, key, len);
+      memcpy(message + len, HANDSHAKE_GUID, sizeof(HANDSHAKE_GUID) - 1);
+      message[messageLen] = 0x80;
+      memset(message + messageLen + 1, 0, blocks * 64 - messageLen - 1);
+      const uint64_t bits = static_cast<uint64_t>(messageLen) * 8;
+      for(int i = 0; i < 8; i++) {
+          message[blocks * 64 - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+      }
+      return blocks;
+  }
+
+  void websocketsHandshakeEncodeKeys(const char* const* keys, const size_t* lens, char (*accepts)[SHA1_BASE64_SIZE], size_t count) {
+      uint8_t messages[2][HANDSHAKE_MESSAGE_SIZE];
+      size_t i = 0;
+      for(; i + 1 < count; i += 2) {
+          const size_t blocks = padHandshakeMessage(keys[i], lens[i], messages[0]);
+          if(blocks == 0 || padHandshakeMessage(keys[i + 1], lens[i + 1], messages[1]) != blocks) {
+              // odd sized keys, not worth pairing
+              memcpy(accepts[i], websocketsHandshakeEncodeKey(keys[i], lens[i]).c_str(), SHA1_BASE64_SIZE);
+              memcpy(accepts[i + 1], websocketsHandshakeEncodeKey(keys[i + 1], lens[i + 1]).c_str(), SHA1_BASE64_SIZE);
+              continue;
+          }
 
+          internals::sha1 first, second;
+          internals::sha1_process_blocks_x2(first.state, messages[0], second.state, messages[1], blocks);
+          first.print_base64(accepts[i]);
+          second.print_base64(accepts[i + 1]);
+      }
+
+      if(i < count) {
+          memcpy(accepts[i], websocketsHandshakeEncodeKey(keys[i], lens[i]).c_str(), SHA1_BASE64_SIZE);
+      }
+  }
+
+  // Fills `buffer` from the platform's entropy source, only used to seed the generator
+  void readEntropy(uint8_t* buffer, size_t len) {
+#if defined(_WS_CONFIG_NO_TRUE_RANDOMNESS)
+    // fixed seed, every run produces the same sequence
+    for(size_t i = 0; i < len; i++) buffer[i] = static_cast<uint8_t>(i);
+#elif defined(ESP32) || defined(ESP8266)
+    for(size_t i = 0; i < len; i += 4) {
+  #ifdef ESP32
+      uint32_t value = esp_random();
+  #else
+      uint32_t value = ESP.random();
+  #endif
+      memcpy(buffer + i, &value, len - i < 4 ? len - i : 4);
+    }
+#elif defined(__linux__)
+    size_t done = 0;
+    while(done < len) {
+      ssize_t res = getrandom(buffer + done, len - done, 0);
+      if(res > 0) done += res;
+      else if(res < 0 && errno != EINTR) break;
+    }
+    if(done < len) {
+      // very old kernels, fall back to the device
+      FILE* urandom = fopen("/dev/urandom", "rb");
+      if(urandom) {
+        done += fread(buffer + done, 1, len - done, urandom);
+        fclose(urandom);
+      }
+    }
+#else
+    // no known hardware source on this platform: timing jitter only, weak but never a fixed pattern
     for(size_t i = 0; i < len; i++) {
-      result += "0123456789abcdef"[i % 16];
+  #ifdef ARDUINO
+      buffer[i] = static_cast<uint8_t>(micros() ^ random(256));
+  #else
+      buffer[i] = static_cast<uint8_t>(time(NULL) ^ clock() ^ (i * 131));
+  #endif
     }
+#endif
+  }
 
-    return result;
+  inline uint32_t rotateLeft(const uint32_t value, const int bits) {
+    return (value << bits) | (value >> (32 - bits));
   }
-#else
-  WSString randomBytes(size_t len) {
-    static int onlyOnce = [](){
-      srand(time(NULL));
-      return 0;
-    }();
 
-    WSString result;
-    result.reserve(len);
+  #define CHACHA_QUARTER_ROUND(a, b, c, d) \
+    a += b; d = rotateLeft(d ^ a, 16); \
+    c += d; b = rotateLeft(b ^ c, 12); \
+    a += b; d = rotateLeft(d ^ a, 8); \
+    c += d; b = rotateLeft(b ^ c, 7);
 
-    for(size_t i = onlyOnce; i < len; i++) {
-      result += "0123456789abcdefABCDEFGHIJKLMNOPQRSTUVEXYZ"[rand() % 42];
+  // The ChaCha20 keystream used as a random generator, keyed once from the entropy source.
+  // Every block gives 64 bytes (16 masking keys) for 20 rounds of additions, xors and rotations
+  class RandomGenerator {
+  public:
+    RandomGenerator() {
+      reseed();
     }
-    return result;
+
+    // a new key from the entropy source, what is left of the current block is dropped
+    void reseed() {
+      uint8_t seed[40];
+      readEntropy(seed, sizeof(seed));
+
+      // "expand 32-byte k"
+      _state[0] = 0x61707865; _state[1] = 0x3320646e; _state[2] = 0x79622d32; _state[3] = 0x6b206574;
+      memcpy(&_state[4], seed, 32);
+      _state[12] = 0;
+      _state[13] = 0;
+      memcpy(&_state[14], seed + 32, 8);
+      memset(seed, 0, sizeof(seed));
+
+      memset(_block, 0, sizeof(_block));
+      _used = sizeof(_block);
+    }
+
+    void fill(uint8_t* buffer, size_t len) {
+      while(len > 0) {
+        if(_used == sizeof(_block)) refill();
+
+        size_t chunk = sizeof(_block) - _used;
+        if(chunk > len) chunk = len;
+        memcpy(buffer, reinterpret_cast<uint8_t*>(_block) + _used, chunk);
+        // used bytes are wiped, they are never handed out twice
+        memset(reinterpret_cast<uint8_t*>(_block) + _used, 0, chunk);
+
+        _used += chunk;
+        buffer += chunk;
+        len -= chunk;
+      }
+    }
+
+  private:
+    uint32_t _state[16];
+    uint32_t _block[16];
+    size_t _used;
+
+    void refill() {
+      uint32_t x[16];
+      memcpy(x, _state, sizeof(x));
+      for(int round = 0; round < 20; round += 2) {
+        CHACHA_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        CHACHA_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        CHACHA_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        CHACHA_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        CHACHA_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        CHACHA_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        CHACHA_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        CHACHA_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+      }
+      for(int i = 0; i < 16; i++) {
+        _block[i] = x[i] + _state[i];
+      }
+
+      // 64 bit block counter
+      if(++_state[12] == 0) ++_state[13];
+      _used = 0;
+    }
+  };
+
+  // The generator is shared by every thread (every task on ESP32)
+#if defined(ESP32)
+  static portMUX_TYPE generatorMux = portMUX_INITIALIZER_UNLOCKED;
+#elif !defined(ARDUINO)
+  static std::mutex generatorMutex;
+#endif
+
+#ifdef __linux__
+  // A forked child starts with a copy of the parent's keystream, it reseeds before using it.
+  // The lock is held across `fork`, so the child never inherits it locked by another thread
+  static bool reseedAfterFork = false;
+  static void lockGeneratorForFork() { generatorMutex.lock(); }
+  static void unlockGeneratorInParent() { generatorMutex.unlock(); }
+  static void unlockGeneratorInChild() {
+    reseedAfterFork = true;
+    generatorMutex.unlock();
   }
 #endif
+
+  void randomFill(uint8_t* buffer, size_t len) {
+#ifdef __linux__
+    // registered before there is any keystream a child could copy
+    static const int forkHandlers = pthread_atfork(lockGeneratorForFork, unlockGeneratorInParent, unlockGeneratorInChild);
+    (void) forkHandlers;
+#endif
+    // seeded outside of the lock, reading the entropy source can't happen in an ESP32 critical section
+    static RandomGenerator generator;
+
+#if defined(ESP32)
+    portENTER_CRITICAL(&generatorMux);
+#elif !defined(ARDUINO)
+    std::lock_guard<std::mutex> lock(generatorMutex);
+#endif
+
+#ifdef __linux__
+    if(reseedAfterFork) {
+      reseedAfterFork = false;
+      generator.reseed();
+    }
+#endif
+    generator.fill(buffer, len);
+
+#if defined(ESP32)
+    portEXIT_CRITICAL(&generatorMux);
+#endif
+  }
+
+  WSString randomBytes(size_t len) {
+    WSString result(len, '\0');
+    randomFill(reinterpret_cast<uint8_t*>(&result[0]), len);
+    return result;
+  }
+
+  uint32_t randomNumber() {
+    uint32_t result;
+    randomFill(reinterpret_cast<uint8_t*>(&result), sizeof(result));
+    return result;
+  }
 }} // websockets::crypto
\ No newline at end of file
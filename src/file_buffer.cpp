@@ -0,0 +1,64 @@
+#ifdef __linux__
+
+#include <tiny_websockets/internals/file_buffer.hpp>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+
+namespace websockets { namespace internals {
+    bool FileBuffer::open(const char* directory) {
+#ifdef O_TMPFILE
+        this->_fd = ::open(directory, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+        if(this->_fd >= 0) return true;
+#endif
+        // no O_TMPFILE (old kernel or file system): create a named file and unlink it right away
+        WSString path = directory;
+        path += "/tiny_websockets_XXXXXX";
+        this->_fd = mkostemp(&path[0], O_CLOEXEC);
+        if(this->_fd < 0) return false;
+        unlink(path.c_str());
+        return true;
+    }
+
+    bool FileBuffer::append(const char* data, const size_t len) {
+        if(this->_fd < 0 || this->_mapping != nullptr) return false;
+
+        size_t done = 0;
+        while(done < len) {
+            const ssize_t written = ::write(this->_fd, data + done, len - done);
+            if(written < 0) {
+                if(errno == EINTR) continue;
+                return false;
+            }
+            done += written;
+        }
+        this->_size += len;
+        return true;
+    }
+
+    bool FileBuffer::map() {
+        if(this->_mapping != nullptr) return true;
+        // the terminating null byte is part of the file, so it's mapped even when the size is a page multiple
+        if(!append("", 1)) return false;
+        this->_size -= 1;
+
+        void* mapping = mmap(nullptr, this->_size + 1, PROT_READ, MAP_SHARED, this->_fd, 0);
+        if(mapping == MAP_FAILED) return false;
+
+        // the mapping keeps the file alive
+        ::close(this->_fd);
+        this->_fd = -1;
+        this->_mapping = static_cast<char*>(mapping);
+        return true;
+    }
+
+    FileBuffer::~FileBuffer() {
+        if(this->_mapping != nullptr) munmap(this->_mapping, this->_size + 1);
+        if(this->_fd >= 0) ::close(this->_fd);
+    }
+}} // websockets::internals
+
+#endif // #ifdef __linux__
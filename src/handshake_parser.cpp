@@ -0,0 +1,151 @@
+#include <tiny_websockets/internals/handshake_parser.hpp>
+#include <string.h>
+
+namespace websockets { namespace internals {
+    inline char toLowerCase(const char ch) {
+        return ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch;
+    }
+
+    inline bool isOptionalWhitespace(const char ch) {
+        return ch == ' ' || ch == '\t';
+    }
+
+    bool equalsIgnoreCase(const char* lhs, const char* rhs, const size_t len) {
+        for(size_t i = 0; i < len; i++) {
+            if(toLowerCase(lhs[i]) != toLowerCase(rhs[i])) return false;
+        }
+        return true;
+    }
+
+    StringView trim(const char* begin, const char* end) {
+        while(begin < end && isOptionalWhitespace(*begin)) begin++;
+        while(end > begin && isOptionalWhitespace(*(end - 1))) end--;
+        return StringView(begin, end - begin);
+    }
+
+    bool StringView::equals(const char* other) const {
+        const size_t len = strlen(other);
+        return len == this->size && memcmp(this->data, other, len) == 0;
+    }
+
+    bool StringView::equalsIgnoreCase(const char* other) const {
+        const size_t len = strlen(other);
+        return len == this->size && internals::equalsIgnoreCase(this->data, other, len);
+    }
+
+    bool StringView::startsWith(const char* prefix) const {
+        const size_t len = strlen(prefix);
+        return len <= this->size && memcmp(this->data, prefix, len) == 0;
+    }
+
+    bool StringView::containsTokenIgnoreCase(const char* token) const {
+        const char* current = this->data;
+        const char* end = this->data + this->size;
+        while(current < end) {
+            const char* comma = static_cast<const char*>(memchr(current, ',', end - current));
+            const char* tokenEnd = comma ? comma : end;
+
+            if(trim(current, tokenEnd).equalsIgnoreCase(token)) return true;
+            current = tokenEnd + 1;
+        }
+        return false;
+    }
+
+    bool readHandshakeHeaders(network::TcpClient& client, WSString& buffer) {
+        // first line and headers are read into the same buffer, they are parsed in place later
+        buffer.reserve(_WS_BUFFER_SIZE);
+        buffer += client.readLine();
+        if(buffer.empty()) return false;
+
+        while(client.available()) {
+            const size_t lineBegin = buffer.size();
+            buffer += client.readLine();
+
+            // readLine returns an empty string on timeout
+            if(buffer.size() == lineBegin) return false;
+
+            // the empty line terminates the headers block
+            if(buffer.size() - lineBegin == 2 && buffer[lineBegin] == '\r') return true;
+        }
+        return false;
+    }
+
+    // Assigns `value` to the header we care about (if any). Dispatching on the key's length
+    // first means most irrelevant headers are skipped without comparing them at all
+    void storeHeader(const StringView& key, const StringView& value, HandshakeHeaders& result) {
+        switch(key.size) {
+            case 7:
+                if(key.equalsIgnoreCase("upgrade")) result.upgrade = value;
+                break;
+            case 10:
+                if(key.equalsIgnoreCase("connection")) result.connection = value;
+                break;
+            case 17:
+                if(key.equalsIgnoreCase("sec-websocket-key")) result.secWebSocketKey = value;
+                break;
+            case 20:
+                if(key.equalsIgnoreCase("sec-websocket-accept")) result.secWebSocketAccept = value;
+                break;
+            case 21:
+                if(key.equalsIgnoreCase("sec-websocket-version")) result.secWebSocketVersion = value;
+                break;
+        }
+    }
+
+    bool parseHandshakeHeaders(const char* buffer, const size_t len, HandshakeHeaders& result) {
+        const char* current = buffer;
+        const char* end = buffer + len;
+        bool isFirstLine = true;
+
+        while(current < end) {
+            const char* newLine = static_cast<const char*>(memchr(current, '\n', end - current));
+            if(newLine == nullptr) return false; // incomplete line
+
+            const char* lineEnd = newLine;
+            if(lineEnd > current && *(lineEnd - 1) == '\r') lineEnd--;
+
+            // empty line, end of headers
+            if(lineEnd == current) return !isFirstLine;
+
+            if(isFirstLine) {
+                result.firstLine = StringView(current, lineEnd - current);
+                isFirstLine = false;
+            } else {
+                const char* colon = static_cast<const char*>(memchr(current, ':', lineEnd - current));
+                if(colon != nullptr) {
+                    storeHeader(
+                        StringView(current, colon - current),
+                        trim(colon + 1, lineEnd),
+                        result
+                    );
+                }
+            }
+
+            current = newLine + 1;
+        }
+
+        // no terminating empty line
+        return false;
+    }
+
+    bool isValidUpgradeResponse(const HandshakeHeaders& headers, const char* expectedAcceptKey) {
+        if(!headers.firstLine.startsWith("HTTP/1.1 101")) return false;
+
+        bool isSuccess = !headers.secWebSocketAccept.empty() &&
+                          headers.upgrade.equalsIgnoreCase("websocket") &&
+                          headers.connection.containsTokenIgnoreCase("upgrade");
+
+#ifdef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
+        bool serverAcceptMismatch = false;
+        (void) expectedAcceptKey;
+#else
+        bool serverAcceptMismatch = !headers.secWebSocketAccept.equals(expectedAcceptKey);
+#endif
+        return isSuccess && !serverAcceptMismatch;
+    }
+
+    const char* handshakeHost(const char* host) {
+        if(host[0] == '\0' || host[0] == '/' || host[0] == '@') return "localhost";
+        return host;
+    }
+}} // websockets::internals
@@ -0,0 +1,183 @@
+#if defined(__linux__) && defined(_WS_CONFIG_SIMULATE_HEAP)
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/internals/heap_simulation.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace websockets { namespace internals {
+    namespace {
+        // Blocks are laid out back to back in the arena, each starts with this header (padded to a granule)
+        struct Block {
+            size_t size; // including the header
+            bool used;
+        };
+
+        const size_t Granule = alignof(std::max_align_t);
+        const size_t ArenaSize = (static_cast<size_t>(_WS_CONFIG_SIMULATE_HEAP) / Granule) * Granule;
+        static_assert(sizeof(Block) <= Granule, "the block header must fit in a granule");
+        static_assert(ArenaSize >= 2 * Granule, "_WS_CONFIG_SIMULATE_HEAP is too small");
+
+        // zero initialized, so it is usable by allocations made before main
+        alignas(std::max_align_t) unsigned char arena[ArenaSize];
+        bool initialized = false;
+        HeapStats stats;
+        std::mutex lock;
+
+        Block* blockAt(unsigned char* position) {
+            return reinterpret_cast<Block*>(position);
+        }
+
+        unsigned char* end(Block* block) {
+            return reinterpret_cast<unsigned char*>(block) + block->size;
+        }
+
+        void initialize() {
+            auto first = blockAt(arena);
+            first->size = ArenaSize;
+            first->used = false;
+            stats.capacity = ArenaSize;
+            initialized = true;
+        }
+
+        // merges the free blocks that follow `block` into it (a free block before it is merged
+        // into it when a scan reaches that one)
+        void coalesce(Block* block) {
+            while(end(block) < arena + ArenaSize && !blockAt(end(block))->used) {
+                block->size += blockAt(end(block))->size;
+            }
+        }
+
+        void* allocate(size_t size) {
+            std::lock_guard<std::mutex> guard(lock);
+            if(!initialized) initialize();
+
+            if(size > ArenaSize) {
+                stats.failures++;
+                return nullptr;
+            }
+            const size_t needed = Granule + (size == 0 ? Granule : (size + Granule - 1) / Granule * Granule);
+
+            // first fit
+            for(auto position = arena; position < arena + ArenaSize; position = end(blockAt(position))) {
+                auto block = blockAt(position);
+                if(block->used) continue;
+
+                coalesce(block);
+                if(block->size < needed) continue;
+
+                // keep the rest as a free block, unless it couldn't hold anything
+                if(block->size - needed >= 2 * Granule) {
+                    auto rest = blockAt(position + needed);
+                    rest->size = block->size - needed;
+                    rest->used = false;
+                    block->size = needed;
+                }
+
+                block->used = true;
+                stats.used += block->size;
+                if(stats.used > stats.peakUsed) stats.peakUsed = stats.used;
+                stats.allocations++;
+                return position + Granule;
+            }
+
+            stats.failures++;
+            return nullptr;
+        }
+
+        bool release(void* pointer) {
+            auto position = static_cast<unsigned char*>(pointer);
+            if(position < arena || position >= arena + ArenaSize) return false;
+
+            std::lock_guard<std::mutex> guard(lock);
+            auto block = blockAt(position - Granule);
+            block->used = false;
+            stats.used -= block->size;
+            coalesce(block);
+            return true;
+        }
+
+        void* allocateOrFallBack(size_t size) {
+            void* pointer = allocate(size);
+            // the failure is counted, the system heap keeps the program running
+            if(!pointer) pointer = std::malloc(size == 0 ? 1 : size);
+            return pointer;
+        }
+
+        void deallocate(void* pointer) {
+            if(pointer && !release(pointer)) std::free(pointer);
+        }
+    } // namespace
+
+    HeapStats getHeapStats() {
+        std::lock_guard<std::mutex> guard(lock);
+        if(!initialized) initialize();
+
+        HeapStats result = stats;
+        result.largestFreeBlock = 0;
+        for(auto position = arena; position < arena + ArenaSize; position = end(blockAt(position))) {
+            auto block = blockAt(position);
+            if(block->used) continue;
+
+            coalesce(block);
+            if(block->size - Granule > result.largestFreeBlock) result.largestFreeBlock = block->size - Granule;
+        }
+        return result;
+    }
+
+    void resetHeapPeak() {
+        std::lock_guard<std::mutex> guard(lock);
+        stats.peakUsed = stats.used;
+    }
+}} // websockets::internals
+
+void* operator new(std::size_t size) {
+    void* pointer = websockets::internals::allocateOrFallBack(size);
+    if(!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size) {
+    void* pointer = websockets::internals::allocateOrFallBack(size);
+    if(!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return websockets::internals::allocateOrFallBack(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return websockets::internals::allocateOrFallBack(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    websockets::internals::deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    websockets::internals::deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    websockets::internals::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    websockets::internals::deallocate(pointer);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void* pointer, std::size_t) noexcept {
+    websockets::internals::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    websockets::internals::deallocate(pointer);
+}
+#endif
+
+#endif // #if defined(__linux__) && defined(_WS_CONFIG_SIMULATE_HEAP)
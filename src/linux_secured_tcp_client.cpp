@@ -0,0 +1,382 @@
+#if defined(__linux__) && !defined(_WS_CONFIG_NO_SSL)
+
+#include <tiny_websockets/network/linux/linux_secured_tcp_client.hpp>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+
+namespace websockets { namespace network {
+    // the last session of every host:port and trust settings / client identity, shared by all the clients
+    static std::mutex sessionCacheMutex;
+    static std::map<WSString, SSL_SESSION*> sessionCache;
+
+    // called by OpenSSL whenever the server hands out a session (with TLS 1.3, after the handshake)
+    int onNewSession(SSL* ssl, SSL_SESSION* session) {
+        auto client = static_cast<SecuredLinuxTcpClient*>(SSL_get_app_data(ssl));
+        if(client == nullptr || client->_sessionKey.empty()) return 0;
+
+        std::lock_guard<std::mutex> lock(sessionCacheMutex);
+        SSL_SESSION*& cached = sessionCache[client->_sessionKey];
+        if(cached) SSL_SESSION_free(cached);
+        cached = session;
+        return 1; // we own the reference now
+    }
+
+    SSL_CTX* sharedContext() {
+        static SSL_CTX* context = [](){
+            SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+            SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+            SSL_CTX_set_default_verify_paths(ctx);
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(ctx, onNewSession);
+            return ctx;
+        }();
+        return context;
+    }
+
+    X509_STORE* loadCertStore(const char* pem) {
+        BIO* bio = BIO_new_mem_buf(pem, -1);
+        X509_STORE* store = X509_STORE_new();
+        while(X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr)) {
+            X509_STORE_add_cert(store, cert);
+            X509_free(cert);
+        }
+        ERR_clear_error(); // reading stops with an error at the end of the buffer
+        BIO_free(bio);
+        return store;
+    }
+
+    SecuredLinuxTcpClient::SecuredLinuxTcpClient() :
+        _ssl(nullptr),
+        _handshaking(false),
+        _caCert(nullptr),
+        _clientCert(nullptr),
+        _privateKey(nullptr),
+        _insecure(false),
+        _sessionReused(false),
+        _kernelTls(false),
+        _kernelTx(false) {
+        // Empty
+    }
+
+    // feeds a PEM string (or its absence) to the digest, with a separator so fields can't run into each other
+    void digestPem(EVP_MD_CTX* ctx, const char* pem) {
+        if(pem) EVP_DigestUpdate(ctx, pem, strlen(pem));
+        EVP_DigestUpdate(ctx, pem ? "\x01" : "\x00", 1);
+    }
+
+    // Sessions are only resumed with the same trust settings and client identity, since resuming skips
+    // verifying the peer and re-authenticates with the identity of the cached session. The PEM contents
+    // are digested, a pointer would match a different certificate loaded at the same address
+    void SecuredLinuxTcpClient::setSessionKey(const WSString& host, const int port) {
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int digestLen = 0;
+        EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+        EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr);
+        EVP_DigestUpdate(ctx, this->_insecure ? "insecure" : "verify", this->_insecure ? 8 : 6);
+        digestPem(ctx, this->_insecure ? nullptr : this->_caCert);
+        digestPem(ctx, this->_clientCert);
+        digestPem(ctx, this->_privateKey);
+        EVP_DigestFinal_ex(ctx, digest, &digestLen);
+        EVP_MD_CTX_free(ctx);
+
+        char suffix[16 + 2 * EVP_MAX_MD_SIZE];
+        int written = snprintf(suffix, sizeof(suffix), ":%d/", port);
+        for(unsigned int i = 0; i < digestLen; i++) {
+            written += snprintf(suffix + written, sizeof(suffix) - written, "%02x", digest[i]);
+        }
+        this->_host = host;
+        this->_sessionKey = host + suffix;
+    }
+
+    bool SecuredLinuxTcpClient::startTls(const WSString& host) {
+        // OpenSSL handles the socket in non-blocking mode, waits are done with poll (see `waitFor`)
+        int flags = fcntl(getSocket(), F_GETFL, 0);
+        fcntl(getSocket(), F_SETFL, flags | O_NONBLOCK);
+
+        this->_ssl = SSL_new(sharedContext());
+        SSL_set_fd(this->_ssl, getSocket());
+        SSL_set_app_data(this->_ssl, this);
+        SSL_set_tlsext_host_name(this->_ssl, host.c_str());
+#ifdef SSL_OP_ENABLE_KTLS
+        if(this->_kernelTls) SSL_set_options(this->_ssl, SSL_OP_ENABLE_KTLS);
+#endif
+
+        if(this->_insecure) {
+            SSL_set_verify(this->_ssl, SSL_VERIFY_NONE, nullptr);
+        } else {
+            SSL_set_verify(this->_ssl, SSL_VERIFY_PEER, nullptr);
+            SSL_set1_host(this->_ssl, host.c_str());
+            if(this->_caCert) {
+                X509_STORE* store = loadCertStore(this->_caCert);
+                SSL_set1_verify_cert_store(this->_ssl, store);
+                X509_STORE_free(store);
+            }
+        }
+
+        if(this->_clientCert && this->_privateKey) {
+            BIO* certBio = BIO_new_mem_buf(this->_clientCert, -1);
+            X509* cert = PEM_read_bio_X509(certBio, nullptr, nullptr, nullptr);
+            BIO* keyBio = BIO_new_mem_buf(this->_privateKey, -1);
+            EVP_PKEY* key = PEM_read_bio_PrivateKey(keyBio, nullptr, nullptr, nullptr);
+            bool loaded = cert && key && SSL_use_certificate(this->_ssl, cert) == 1 && SSL_use_PrivateKey(this->_ssl, key) == 1;
+            X509_free(cert);
+            EVP_PKEY_free(key);
+            BIO_free(certBio);
+            BIO_free(keyBio);
+            if(!loaded) return false;
+        }
+
+        std::lock_guard<std::mutex> lock(sessionCacheMutex);
+        auto cached = sessionCache.find(this->_sessionKey);
+        if(cached != sessionCache.end()) {
+            SSL_set_session(this->_ssl, cached->second);
+        }
+        return true;
+    }
+
+    bool SecuredLinuxTcpClient::continueHandshake() {
+        int res = SSL_connect(this->_ssl);
+        if(res == 1) {
+            this->_handshaking = false;
+            this->_sessionReused = SSL_session_reused(this->_ssl) == 1;
+#ifdef SSL_OP_ENABLE_KTLS
+            this->_kernelTx = this->_kernelTls && BIO_get_ktls_send(SSL_get_wbio(this->_ssl));
+#endif
+            return false;
+        }
+
+        int error = SSL_get_error(this->_ssl, res);
+        if(error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return true;
+
+        ERR_clear_error();
+        close();
+        return false;
+    }
+
+    SecuredLinuxTcpClient::IoResult SecuredLinuxTcpClient::handleIoError(const int result) {
+        switch(SSL_get_error(this->_ssl, result)) {
+            case SSL_ERROR_WANT_READ:
+                return waitFor(POLLIN) ? IoResult_Retry : IoResult_TimedOut;
+            case SSL_ERROR_WANT_WRITE:
+                return waitFor(POLLOUT) ? IoResult_Retry : IoResult_TimedOut;
+            default:
+                ERR_clear_error();
+                return IoResult_Failed;
+        }
+    }
+
+    bool SecuredLinuxTcpClient::connect(const WSString& host, int port) {
+        if(!LinuxTcpClient::connect(host, port)) return false;
+
+        setSessionKey(host, port);
+        this->_handshaking = true;
+        if(!startTls(host)) {
+            close();
+            return false;
+        }
+
+        while(continueHandshake()) {
+            int error = SSL_get_error(this->_ssl, -1);
+            if(!waitFor(error == SSL_ERROR_WANT_WRITE ? POLLOUT : POLLIN)) {
+                close();
+                return false;
+            }
+        }
+        return available();
+    }
+
+    bool SecuredLinuxTcpClient::beginConnect(const WSString& host, int port) {
+        if(!LinuxTcpClient::beginConnect(host, port)) return false;
+
+        setSessionKey(host, port);
+        this->_handshaking = true;
+        return true;
+    }
+
+    bool SecuredLinuxTcpClient::isConnecting() {
+        if(LinuxTcpClient::isConnecting()) return true;
+        if(!this->_handshaking) return false;
+
+        // the TCP connect is done (or failed), the TLS handshake follows
+        if(getSocket() == INVALID_SOCKET) {
+            this->_handshaking = false;
+            return false;
+        }
+        if(this->_ssl == nullptr) {
+            if(!startTls(this->_host)) {
+                close();
+                return false;
+            }
+        }
+        return continueHandshake();
+    }
+
+    bool SecuredLinuxTcpClient::poll() {
+        if(!available()) return false;
+        if(SSL_pending(this->_ssl) > 0) return true;
+        if(!LinuxTcpClient::poll()) return false;
+
+        // the socket can be readable with only protocol records (ex. session tickets), peek to find out
+        char ch;
+        int res = SSL_peek(this->_ssl, &ch, 1);
+        if(res > 0) return true;
+
+        int error = SSL_get_error(this->_ssl, res);
+        if(error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return false;
+
+        // closed or failed, let the caller's read notice it
+        return true;
+    }
+
+    bool SecuredLinuxTcpClient::available() {
+        return this->_ssl != nullptr && !this->_handshaking && LinuxTcpClient::available();
+    }
+
+    void SecuredLinuxTcpClient::send(const WSString& data) {
+        this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+
+    void SecuredLinuxTcpClient::send(const WSString&& data) {
+        this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+
+    void SecuredLinuxTcpClient::send(const uint8_t* data, const uint32_t len) {
+        if(this->_kernelTx) {
+            // the kernel builds the records, so this is a plain write
+            LinuxTcpClient::send(data, len);
+            return;
+        }
+
+        uint32_t done = 0;
+        while(available() && done < len) {
+            int res = SSL_write(this->_ssl, data + done, len - done);
+            if(res > 0) {
+                done += res;
+            } else if(handleIoError(res) != IoResult_Retry) {
+                close();
+            }
+        }
+    }
+
+    WSString SecuredLinuxTcpClient::readLine() {
+        WSString line;
+
+        // records are buffered by OpenSSL, so reading a byte at a time doesn't cost a syscall per byte
+        while(available()) {
+            char ch;
+            int res = SSL_read(this->_ssl, &ch, 1);
+            if(res > 0) {
+                line += ch;
+                if(ch == '\n') break;
+                continue;
+            }
+
+            IoResult result = handleIoError(res);
+            if(result == IoResult_TimedOut) return "";
+            if(result == IoResult_Failed) {
+                close();
+                return "";
+            }
+        }
+
+        return line;
+    }
+
+    uint32_t SecuredLinuxTcpClient::read(uint8_t* buffer, const uint32_t len) {
+        uint32_t done = 0;
+        while(available() && done < len) {
+            int res = SSL_read(this->_ssl, buffer + done, len - done);
+            if(res > 0) {
+                done += res;
+                continue;
+            }
+
+            IoResult result = handleIoError(res);
+            if(result == IoResult_TimedOut) break;
+            if(result == IoResult_Failed) close();
+        }
+        return done;
+    }
+
+    bool SecuredLinuxTcpClient::readAvailableUntil(WSString& data, const char* terminator, const size_t maxLen) {
+        // the socket holds records, not data: go through SSL_read (see `poll`)
+        return TcpClient::readAvailableUntil(data, terminator, maxLen);
+    }
+
+    bool SecuredLinuxTcpClient::sendFile(int fd, uint64_t offset, uint64_t len) {
+        if(!this->_kernelTx) return false;
+
+#ifdef SSL_OP_ENABLE_KTLS
+        uint64_t done = 0;
+        while(available() && done < len) {
+            auto res = SSL_sendfile(this->_ssl, fd, offset + done, len - done, 0);
+            if(res > 0) {
+                done += res;
+            } else if(handleIoError(static_cast<int>(res)) != IoResult_Retry) {
+                close();
+            }
+        }
+        return done == len;
+#else
+        return false;
+#endif
+    }
+
+    void SecuredLinuxTcpClient::close() {
+        if(this->_ssl) {
+            // best effort close_notify, the socket is non-blocking so this never waits
+            if(!this->_handshaking) SSL_shutdown(this->_ssl);
+            SSL_free(this->_ssl);
+            this->_ssl = nullptr;
+            ERR_clear_error();
+        }
+        this->_handshaking = false;
+        this->_kernelTx = false;
+        LinuxTcpClient::close();
+    }
+
+    void SecuredLinuxTcpClient::setCACert(const char* ca_cert) {
+        this->_caCert = ca_cert;
+        this->_insecure = false;
+    }
+
+    void SecuredLinuxTcpClient::setCertificate(const char* client_ca) {
+        this->_clientCert = client_ca;
+    }
+
+    void SecuredLinuxTcpClient::setPrivateKey(const char* private_key) {
+        this->_privateKey = private_key;
+    }
+
+    void SecuredLinuxTcpClient::setInsecure() {
+        this->_caCert = nullptr;
+        this->_insecure = true;
+    }
+
+    void SecuredLinuxTcpClient::setKernelTls(const bool enable) {
+        this->_kernelTls = enable;
+    }
+
+    bool SecuredLinuxTcpClient::isKernelTlsActive() const {
+        return this->_kernelTx;
+    }
+
+    bool SecuredLinuxTcpClient::isSessionReused() const {
+        return this->_sessionReused;
+    }
+
+    SecuredLinuxTcpClient::~SecuredLinuxTcpClient() {
+        close();
+    }
+}} // websockets::network
+
+#endif // #if defined(__linux__) && !defined(_WS_CONFIG_NO_SSL)
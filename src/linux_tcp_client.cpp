@@ -0,0 +1,368 @@
+#ifdef __linux__
+
+// ws_common first: it includes the secured client, which needs LinuxTcpClient to be complete
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/linux/linux_tcp_client.hpp>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <sys/sendfile.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+namespace websockets { namespace network {
+    LinuxTcpClient::LinuxTcpClient(int socket) : _socket(socket), _connecting(false) {}
+
+    // A host name resolved for `beginConnect`. The resolving thread keeps a reference, so a connect that
+    // is abandoned meanwhile (closed, or timed out by the caller) just drops the result when it arrives
+    struct LinuxTcpClient::Resolution {
+        WSString host;
+        int port;
+        int result = 0;
+        struct addrinfo* addresses = nullptr;
+        // the address being connected to, and the ones left to try if it fails
+        const struct addrinfo* current = nullptr;
+        const struct addrinfo* next = nullptr;
+        std::atomic<bool> done{false};
+
+        ~Resolution() {
+            if(this->addresses) freeaddrinfo(this->addresses);
+        }
+    };
+
+    void setNoDelay(int socket) {
+        int noDelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
+    bool LinuxTcpClient::connectTo(const struct sockaddr* address, socklen_t addressLen, bool nonBlocking) {
+        int sock = ::socket(address->sa_family, SOCK_STREAM | SOCK_CLOEXEC | (nonBlocking ? SOCK_NONBLOCK : 0), 0);
+        if(sock == INVALID_SOCKET) return false;
+
+        if(::connect(sock, address, addressLen) == 0) {
+            this->_socket = sock;
+            return true;
+        }
+        if(nonBlocking && errno == EINPROGRESS) {
+            this->_socket = sock;
+            this->_connecting = true;
+            return true;
+        }
+        ::close(sock);
+        return false;
+    }
+
+    int resolve(const WSString& host, int port, struct addrinfo** addresses) {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        char portStr[8];
+        snprintf(portStr, sizeof(portStr), "%d", port);
+        return getaddrinfo(host.c_str(), portStr, &hints, addresses);
+    }
+
+    void LinuxTcpClient::rememberAddress(const struct addrinfo* address, const WSString& host, int port) {
+        auto& cached = *this->_cachedAddress;
+        memcpy(&cached.address, address->ai_addr, address->ai_addrlen);
+        cached.addressLen = address->ai_addrlen;
+        cached.host = host;
+        cached.port = port;
+    }
+
+    bool LinuxTcpClient::connectToAny(const struct addrinfo* addresses, const WSString& host, int port) {
+        for(auto p = addresses; p != nullptr; p = p->ai_next) {
+            if(connectTo(p->ai_addr, p->ai_addrlen, false)) {
+                rememberAddress(p, host, port);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // resolving can take seconds, a thread does it and `isConnecting` connects once it's done
+    void LinuxTcpClient::startResolving(const WSString& host, int port) {
+        auto resolution = std::make_shared<Resolution>();
+        resolution->host = host;
+        resolution->port = port;
+        std::thread([resolution]() {
+            resolution->result = resolve(resolution->host, resolution->port, &resolution->addresses);
+            resolution->next = resolution->addresses;
+            resolution->done.store(true, std::memory_order_release);
+        }).detach();
+
+        this->_resolution = resolution;
+        this->_connecting = true;
+    }
+
+    // starts a non-blocking connect to the next resolved address, false when none is left
+    bool LinuxTcpClient::connectNextAddress() {
+        auto& resolution = *this->_resolution;
+        if(resolution.result != 0) return false;
+
+        while(resolution.next != nullptr) {
+            resolution.current = resolution.next;
+            resolution.next = resolution.next->ai_next;
+            if(connectTo(resolution.current->ai_addr, resolution.current->ai_addrlen, true)) return true;
+        }
+        return false;
+    }
+
+    bool LinuxTcpClient::openSocket(const WSString& host, int port, bool nonBlocking) {
+        close();
+
+        if(!this->_cachedAddress) {
+            this->_cachedAddress = std::unique_ptr<CachedAddress>(new CachedAddress);
+            this->_cachedAddress->addressLen = 0;
+        }
+        auto& cached = *this->_cachedAddress;
+
+        if(cached.addressLen != 0 && cached.port == port && cached.host == host) {
+            if(connectTo(reinterpret_cast<const struct sockaddr*>(&cached.address), cached.addressLen, nonBlocking)) {
+                return true;
+            }
+            // the address might be stale, resolve it again
+            cached.addressLen = 0;
+        }
+
+        if(nonBlocking) {
+            startResolving(host, port);
+            return true;
+        }
+
+        struct addrinfo* addresses;
+        if(resolve(host, port, &addresses) != 0) {
+            return false;
+        }
+        connectToAny(addresses, host, port);
+        freeaddrinfo(addresses);
+
+        return this->_socket != INVALID_SOCKET;
+    }
+
+    bool LinuxTcpClient::connect(const WSString& host, int port) {
+        if(!openSocket(host, port, false)) return false;
+
+        setNoDelay(this->_socket);
+        return true;
+    }
+
+    bool LinuxTcpClient::beginConnect(const WSString& host, int port) {
+        if(!openSocket(host, port, true)) return false;
+
+        if(!this->_connecting) setNoDelay(this->_socket);
+        return true;
+    }
+
+    // Every resolved address is tried in turn until one connects, like the blocking `connect` does
+    bool LinuxTcpClient::isConnecting() {
+        while(this->_connecting) {
+            if(this->_socket == INVALID_SOCKET) {
+                // resolving, the connect starts once the addresses arrived
+                if(!this->_resolution->done.load(std::memory_order_acquire)) return true;
+                if(!connectNextAddress()) {
+                    this->_connecting = false;
+                    this->_resolution.reset();
+                    return false;
+                }
+            }
+
+            struct pollfd pfd = {this->_socket, POLLOUT, 0};
+            if(::poll(&pfd, 1, 0) == 0) return true;
+
+            // the connection attempt is over, find out how it went
+            int error = 0;
+            socklen_t errorLen = sizeof(error);
+            getsockopt(this->_socket, SOL_SOCKET, SO_ERROR, &error, &errorLen);
+
+            if(error == 0) {
+                this->_connecting = false;
+                if(this->_resolution) {
+                    rememberAddress(this->_resolution->current, this->_resolution->host, this->_resolution->port);
+                    this->_resolution.reset();
+                }
+                setNoDelay(this->_socket);
+                return false;
+            }
+
+            ::close(this->_socket);
+            this->_socket = INVALID_SOCKET;
+            if(!this->_resolution) {
+                // the cached address failed, it might be stale: resolve it again
+                auto& cached = *this->_cachedAddress;
+                cached.addressLen = 0;
+                startResolving(cached.host, cached.port);
+            }
+        }
+        return false;
+    }
+
+    bool LinuxTcpClient::poll() {
+        if(!available()) return false;
+
+        struct pollfd pfd = {this->_socket, POLLIN, 0};
+        return ::poll(&pfd, 1, 0) > 0;
+    }
+
+    bool LinuxTcpClient::available() {
+        return this->_socket != INVALID_SOCKET && !this->_connecting;
+    }
+
+    bool LinuxTcpClient::waitFor(short events) {
+        struct pollfd pfd = {this->_socket, events, 0};
+        int res;
+        do {
+            res = ::poll(&pfd, 1, _CONNECTION_TIMEOUT);
+        } while(res < 0 && errno == EINTR);
+        return res > 0;
+    }
+
+    void LinuxTcpClient::send(const WSString& data) {
+        this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+
+    void LinuxTcpClient::send(const WSString&& data) {
+        this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+
+    void LinuxTcpClient::send(const uint8_t* data, const uint32_t len) {
+        uint32_t done = 0;
+        while(available() && done < len) {
+            auto res = ::send(this->_socket, data + done, len - done, MSG_NOSIGNAL);
+            if(res > 0) {
+                done += res;
+            } else if(res < 0 && errno == EINTR) {
+                continue;
+            } else if(res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && waitFor(POLLOUT)) {
+                continue;
+            } else {
+                close();
+            }
+        }
+    }
+
+    WSString LinuxTcpClient::readLine() {
+        WSString line;
+        char buffer[_WS_BUFFER_SIZE];
+
+        // peek for a newline so a whole line is read with a single recv and nothing past it is consumed
+        while(available()) {
+            if(!waitFor(POLLIN)) return "";
+
+            auto peeked = ::recv(this->_socket, buffer, sizeof(buffer), MSG_PEEK);
+            if(peeked < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+            if(peeked <= 0) {
+                close();
+                return "";
+            }
+
+            auto newLine = static_cast<const char*>(memchr(buffer, '\n', peeked));
+            size_t toRead = newLine ? (newLine - buffer) + 1 : peeked;
+
+            auto numRead = ::recv(this->_socket, buffer, toRead, 0);
+            if(numRead <= 0) {
+                close();
+                return "";
+            }
+            line.append(buffer, numRead);
+
+            if(newLine) break;
+        }
+
+        return line;
+    }
+
+    uint32_t LinuxTcpClient::read(uint8_t* buffer, const uint32_t len) {
+        uint32_t done = 0;
+        while(available() && done < len) {
+            auto res = ::recv(this->_socket, buffer + done, len - done, 0);
+            if(res > 0) {
+                done += res;
+            } else if(res < 0 && errno == EINTR) {
+                continue;
+            } else if(res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && waitFor(POLLIN)) {
+                continue;
+            } else if(res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break; // timed out
+            } else {
+                close();
+            }
+        }
+        return done;
+    }
+
+    // peeks at what arrived and only consumes it up to the end of the terminator
+    bool LinuxTcpClient::readAvailableUntil(WSString& data, const char* terminator, const size_t maxLen) {
+        const size_t terminatorLen = strlen(terminator);
+        char buffer[_WS_BUFFER_SIZE];
+
+        while(data.size() < maxLen && available()) {
+            const size_t room = maxLen - data.size() < sizeof(buffer) ? maxLen - data.size() : sizeof(buffer);
+            auto peeked = ::recv(this->_socket, buffer, room, MSG_PEEK | MSG_DONTWAIT);
+            if(peeked < 0 && errno == EINTR) continue;
+            if(peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+            if(peeked <= 0) {
+                close();
+                return false;
+            }
+
+            // the terminator may begin in what was already read
+            const size_t before = data.size();
+            data.append(buffer, peeked);
+            const size_t searchFrom = before >= terminatorLen ? before - terminatorLen + 1 : 0;
+            const size_t found = data.find(terminator, searchFrom);
+            if(found != WSString::npos) data.resize(found + terminatorLen);
+
+            const size_t toRead = data.size() - before;
+            if(::recv(this->_socket, buffer, toRead, MSG_DONTWAIT) != static_cast<ssize_t>(toRead)) {
+                close();
+                return false;
+            }
+            if(found != WSString::npos) return true;
+        }
+        return false;
+    }
+
+    bool LinuxTcpClient::sendFile(int fd, uint64_t offset, uint64_t len) {
+        off_t position = offset;
+        uint64_t done = 0;
+        while(available() && done < len) {
+            auto res = ::sendfile(this->_socket, fd, &position, len - done);
+            if(res > 0) {
+                done += res;
+            } else if(res < 0 && errno == EINTR) {
+                continue;
+            } else if(res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && waitFor(POLLOUT)) {
+                continue;
+            } else if(res < 0 && done == 0 && (errno == EINVAL || errno == ENOSYS)) {
+                return false; // this kind of file can't be sent this way
+            } else {
+                close(); // failed (or the file is shorter than `len`) in the middle of a frame
+            }
+        }
+        return done == len;
+    }
+
+    void LinuxTcpClient::close() {
+        if(this->_socket != INVALID_SOCKET) {
+            ::close(this->_socket);
+            this->_socket = INVALID_SOCKET;
+        }
+        this->_connecting = false;
+        this->_resolution.reset();
+    }
+
+    LinuxTcpClient::~LinuxTcpClient() {
+        close();
+    }
+}} // websockets::network
+
+#endif // #ifdef __linux__
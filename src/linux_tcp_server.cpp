@@ -0,0 +1,96 @@
+#ifdef __linux__
+
+// ws_common first: it includes the unix socket server, which needs LinuxTcpServer to be complete
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/linux/linux_tcp_server.hpp>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace websockets { namespace network {
+    bool LinuxTcpServer::listenOn(const struct sockaddr* address, socklen_t addressLen) {
+        if(available()) close();
+
+        // the listening socket is non-blocking so `acceptPending` can drain it
+        this->_socket = ::socket(address->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(!available()) return false;
+        this->_family = address->sa_family;
+
+        if(this->_family != AF_UNIX) {
+            int reuse = 1;
+            setsockopt(this->_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+
+        if(::bind(this->_socket, address, addressLen) != 0 ||
+           ::listen(this->_socket, this->_num_backlog) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool LinuxTcpServer::listen(const uint16_t port) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+
+        return listenOn(reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+
+    // Accepts every connection that is waiting in the kernel's queue (until EAGAIN)
+    void LinuxTcpServer::acceptPending() {
+        while(available()) {
+            int client = ::accept4(this->_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if(client == INVALID_SOCKET) {
+                if(errno == EINTR || errno == ECONNABORTED) continue;
+                break;
+            }
+
+            if(this->_family != AF_UNIX) {
+                int noDelay = 1;
+                setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            }
+            this->_pending.push_back(client);
+        }
+    }
+
+    bool LinuxTcpServer::poll() {
+        if(this->_pending.empty()) acceptPending();
+        return !this->_pending.empty();
+    }
+
+    TcpClient* LinuxTcpServer::accept() {
+        if(this->_pending.empty()) acceptPending();
+        if(this->_pending.empty()) return new LinuxTcpClient;
+
+        int client = this->_pending.front();
+        this->_pending.pop_front();
+        return new LinuxTcpClient(client);
+    }
+
+    bool LinuxTcpServer::available() {
+        return this->_socket != INVALID_SOCKET;
+    }
+
+    void LinuxTcpServer::close() {
+        for(int client : this->_pending) ::close(client);
+        this->_pending.clear();
+
+        if(available()) {
+            ::close(this->_socket);
+            this->_socket = INVALID_SOCKET;
+        }
+    }
+
+    LinuxTcpServer::~LinuxTcpServer() {
+        close();
+    }
+}} // websockets::network
+
+#endif // #ifdef __linux__
@@ -0,0 +1,44 @@
+#ifdef __linux__
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/linux/linux_unix_socket_client.hpp>
+
+#include <stddef.h>
+
+namespace websockets { namespace network {
+    bool unixSocketAddress(const WSString& path, struct sockaddr_un& address, socklen_t& addressLen) {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if(path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+
+        memcpy(address.sun_path, path.c_str(), path.size());
+        if(path[0] == '@') {
+            // abstract names are not null terminated, every byte of the given length counts
+            address.sun_path[0] = '\0';
+            addressLen = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + path.size());
+        } else {
+            addressLen = static_cast<socklen_t>(sizeof(address));
+        }
+        return true;
+    }
+
+    bool UnixSocketClient::openUnixSocket(const WSString& path, bool nonBlocking) {
+        close();
+
+        struct sockaddr_un address;
+        socklen_t addressLen;
+        if(!unixSocketAddress(path, address, addressLen)) return false;
+
+        return connectTo(reinterpret_cast<const struct sockaddr*>(&address), addressLen, nonBlocking);
+    }
+
+    bool UnixSocketClient::connect(const WSString& host, int) {
+        return openUnixSocket(host, false);
+    }
+
+    bool UnixSocketClient::beginConnect(const WSString& host, int) {
+        return openUnixSocket(host, true);
+    }
+}} // websockets::network
+
+#endif // #ifdef __linux__
@@ -0,0 +1,59 @@
+#ifdef __linux__
+
+// ws_common first: it includes the unix socket server, which needs LinuxTcpServer to be complete
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/linux/linux_unix_socket_server.hpp>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace websockets { namespace network {
+    UnixSocketServer::UnixSocketServer(const WSString& path, size_t backlog) :
+        LinuxTcpServer(backlog), _path(path), _bound(false) {
+        // Empty
+    }
+
+    // A socket file left behind by a server that is gone refuses connections, one that is
+    // still in use is never removed
+    static void removeStaleSocket(const struct sockaddr_un& address, socklen_t addressLen, const WSString& path) {
+        int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(probe == INVALID_SOCKET) return;
+
+        bool stale = ::connect(probe, reinterpret_cast<const struct sockaddr*>(&address), addressLen) != 0 &&
+                     errno == ECONNREFUSED;
+        ::close(probe);
+        if(stale) ::unlink(path.c_str());
+    }
+
+    bool UnixSocketServer::listen(const uint16_t) {
+        if(available()) close();
+
+        struct sockaddr_un address;
+        socklen_t addressLen;
+        if(!unixSocketAddress(this->_path, address, addressLen)) return false;
+
+        const bool abstract = this->_path[0] == '@';
+        if(!abstract) removeStaleSocket(address, addressLen, this->_path);
+
+        if(!listenOn(reinterpret_cast<const struct sockaddr*>(&address), addressLen)) return false;
+        this->_bound = !abstract;
+        return true;
+    }
+
+    void UnixSocketServer::close() {
+        LinuxTcpServer::close();
+
+        if(this->_bound) {
+            ::unlink(this->_path.c_str());
+            this->_bound = false;
+        }
+    }
+
+    UnixSocketServer::~UnixSocketServer() {
+        close();
+    }
+}} // websockets::network
+
+#endif // #ifdef __linux__
@@ -0,0 +1,122 @@
+#include <tiny_websockets/internals/memory_budget.hpp>
+#include <algorithm>
+
+namespace websockets { namespace internals {
+    MemoryAccount::MemoryAccount(std::shared_ptr<MemoryBudget> budget) :
+        _budget(budget),
+        _charged(0),
+        _paused(false),
+        _closeRequested(false),
+        _index(0) {
+        this->_budget->add(*this);
+    }
+
+    void MemoryAccount::charge(const size_t bytes) {
+        const size_t charged = bytes > SIZE_MAX - this->_charged ? SIZE_MAX : this->_charged + bytes;
+        this->_budget->adjust(*this, charged);
+    }
+
+    void MemoryAccount::settle(const size_t bytes) {
+        if(bytes != this->_charged) this->_budget->adjust(*this, bytes);
+    }
+
+    void MemoryAccount::release() {
+        this->_closeRequested = false;
+        settle(0);
+    }
+
+    MemoryAccount::~MemoryAccount() {
+        this->_budget->remove(*this);
+    }
+
+    MemoryBudget::MemoryBudget(const size_t limit, const size_t lowWatermark, const bool closeLargest) :
+        _limit(limit),
+        _lowWatermark(lowWatermark < limit ? lowWatermark : limit),
+        _closeLargest(closeLargest),
+        _throttling(false),
+        _used(0),
+        _activeUsed(0) {
+        // Empty
+    }
+
+    void MemoryBudget::add(MemoryAccount& account) {
+        account._index = this->_accounts.size();
+        this->_accounts.push_back(&account);
+    }
+
+    void MemoryBudget::remove(MemoryAccount& account) {
+        adjust(account, 0);
+
+        MemoryAccount* last = this->_accounts.back();
+        this->_accounts[account._index] = last;
+        last->_index = account._index;
+        this->_accounts.pop_back();
+    }
+
+    void MemoryBudget::adjust(MemoryAccount& account, const size_t charged) {
+        this->_used = this->_used - account._charged + charged;
+        if(!account._paused) {
+            this->_activeUsed = this->_activeUsed - account._charged + charged;
+        }
+        account._charged = charged;
+
+        if(this->_throttling && this->_used <= this->_lowWatermark) {
+            resumeAll();
+            return;
+        }
+        // the paused accounts don't hold enough to get back to the low watermark
+        if(this->_used > this->_limit && this->_activeUsed > this->_lowWatermark) {
+            throttle();
+        }
+        if(this->_throttling && this->_activeUsed == 0 && this->_used > this->_lowWatermark) {
+            resumeSmallest();
+        }
+    }
+
+    void MemoryBudget::pause(MemoryAccount& account) {
+        if(account._paused) return;
+        account._paused = true;
+        this->_activeUsed -= account._charged;
+    }
+
+    void MemoryBudget::resume(MemoryAccount& account) {
+        if(!account._paused) return;
+        account._paused = false;
+        this->_activeUsed += account._charged;
+    }
+
+    // Pauses the largest active accounts until the active ones hold no more than the low watermark
+    void MemoryBudget::throttle() {
+        this->_throttling = true;
+
+        std::vector<MemoryAccount*> largest;
+        for(MemoryAccount* account : this->_accounts) {
+            if(!account->_paused && account->_charged != 0) largest.push_back(account);
+        }
+        std::sort(largest.begin(), largest.end(), [](const MemoryAccount* a, const MemoryAccount* b) {
+            return a->_charged > b->_charged;
+        });
+
+        for(MemoryAccount* account : largest) {
+            if(this->_activeUsed <= this->_lowWatermark) break;
+            pause(*account);
+            if(this->_closeLargest) account->_closeRequested = true;
+        }
+    }
+
+    void MemoryBudget::resumeAll() {
+        this->_throttling = false;
+        for(MemoryAccount* account : this->_accounts) {
+            if(!account->_closeRequested) resume(*account);
+        }
+    }
+
+    void MemoryBudget::resumeSmallest() {
+        MemoryAccount* smallest = nullptr;
+        for(MemoryAccount* account : this->_accounts) {
+            if(!account->_paused || account->_closeRequested || account->_charged == 0) continue;
+            if(smallest == nullptr || account->_charged < smallest->_charged) smallest = account;
+        }
+        if(smallest) resume(*smallest);
+    }
+}} // websockets::internals
@@ -0,0 +1,233 @@
+#include <tiny_websockets/internals/wscrypto/sha1.hpp>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  #define _WS_SHA1_X86
+  #include <immintrin.h>
+  #include <cpuid.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2) || (defined(__GNUC__) && !defined(__clang__)))
+  // gcc can enable the crypto extensions per function, other compilers need them enabled globally
+  #define _WS_SHA1_ARM
+  #include <arm_neon.h>
+  #if defined(__linux__)
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+  #endif
+#endif
+
+namespace websockets { namespace crypto { namespace internals {
+  typedef void (*BlockFunction)(uint32_t state[5], const uint8_t *data, size_t blocks);
+
+  static void processBlocksPortable(uint32_t state[5], const uint8_t *data, size_t blocks) {
+    for(; blocks; blocks--, data += 64) {
+      sha1::process_block_portable(state, data);
+    }
+  }
+
+#ifdef _WS_SHA1_X86
+  #define SHA_NI_TARGET __attribute__((target("sha,sse4.1,ssse3"), always_inline)) inline
+
+  struct ShaNiLane {
+    __m128i abcd, abcdSaved;
+    __m128i e, eSaved;
+    // abcd as it was before the previous group of rounds, it becomes the next e
+    __m128i previous;
+    __m128i w[4];
+  };
+
+  SHA_NI_TARGET static void shaNiLoad(ShaNiLane& lane, const uint32_t state[5]) {
+    lane.abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+    lane.e = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+  }
+
+  SHA_NI_TARGET static void shaNiStore(const ShaNiLane& lane, uint32_t state[5]) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(lane.abcd, 0x1B));
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(lane.e, 3));
+  }
+
+  SHA_NI_TARGET static void shaNiBegin(ShaNiLane& lane, const uint8_t *data) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    lane.abcdSaved = lane.abcd;
+    lane.eSaved = lane.e;
+    for(int i = 0; i < 4; i++) {
+      lane.w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byteSwap);
+    }
+  }
+
+  // Rounds 4*k to 4*k+3. The schedule for the following groups is computed in the shadow of the round
+  template<int k>
+  SHA_NI_TARGET static void shaNiGroup(ShaNiLane& lane) {
+    __m128i e;
+    if(k == 0) e = _mm_add_epi32(lane.e, lane.w[0]);
+    else e = _mm_sha1nexte_epu32(lane.previous, lane.w[k & 3]);
+    lane.previous = lane.abcd;
+    lane.abcd = _mm_sha1rnds4_epu32(lane.abcd, e, k / 5);
+
+    if(k >= 3 && k <= 18) lane.w[(k + 1) & 3] = _mm_sha1msg2_epu32(lane.w[(k + 1) & 3], lane.w[k & 3]);
+    if(k >= 2 && k <= 17) lane.w[(k + 2) & 3] = _mm_xor_si128(lane.w[(k + 2) & 3], lane.w[k & 3]);
+    if(k >= 1 && k <= 16) lane.w[(k + 3) & 3] = _mm_sha1msg1_epu32(lane.w[(k + 3) & 3], lane.w[k & 3]);
+  }
+
+  SHA_NI_TARGET static void shaNiEnd(ShaNiLane& lane) {
+    lane.e = _mm_sha1nexte_epu32(lane.previous, lane.eSaved);
+    lane.abcd = _mm_add_epi32(lane.abcd, lane.abcdSaved);
+  }
+
+  #define SHA_NI_GROUPS(lanes, count) \
+    for(int l = 0; l < count; l++) shaNiGroup<0>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<1>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<2>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<3>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<4>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<5>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<6>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<7>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<8>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<9>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<10>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<11>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<12>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<13>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<14>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<15>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<16>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<17>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<18>(lanes[l]); \
+    for(int l = 0; l < count; l++) shaNiGroup<19>(lanes[l]);
+
+  __attribute__((target("sha,sse4.1,ssse3")))
+  static void processBlocksShaNi(uint32_t state[5], const uint8_t *data, size_t blocks) {
+    ShaNiLane lanes[1];
+    shaNiLoad(lanes[0], state);
+    for(; blocks; blocks--, data += 64) {
+      shaNiBegin(lanes[0], data);
+      SHA_NI_GROUPS(lanes, 1)
+      shaNiEnd(lanes[0]);
+    }
+    shaNiStore(lanes[0], state);
+  }
+
+  __attribute__((target("sha,sse4.1,ssse3")))
+  static void processBlocksShaNiX2(
+      uint32_t firstState[5], const uint8_t *firstData,
+      uint32_t secondState[5], const uint8_t *secondData,
+      size_t blocks) {
+    ShaNiLane lanes[2];
+    shaNiLoad(lanes[0], firstState);
+    shaNiLoad(lanes[1], secondState);
+    for(; blocks; blocks--, firstData += 64, secondData += 64) {
+      shaNiBegin(lanes[0], firstData);
+      shaNiBegin(lanes[1], secondData);
+      SHA_NI_GROUPS(lanes, 2)
+      shaNiEnd(lanes[0]);
+      shaNiEnd(lanes[1]);
+    }
+    shaNiStore(lanes[0], firstState);
+    shaNiStore(lanes[1], secondState);
+  }
+
+  #undef SHA_NI_GROUPS
+  #undef SHA_NI_TARGET
+
+  static bool hasShaNi() {
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    // SSSE3 (bit 9) and SSE4.1 (bit 19)
+    if(!(ecx & (1u << 9)) || !(ecx & (1u << 19))) return false;
+    if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    // SHA (bit 29)
+    return (ebx & (1u << 29)) != 0;
+  }
+#endif // _WS_SHA1_X86
+
+#ifdef _WS_SHA1_ARM
+  #if defined(__GNUC__) && !defined(__clang__)
+    #define SHA_ARM_TARGET __attribute__((target("+crypto")))
+  #else
+    #define SHA_ARM_TARGET
+  #endif
+
+  SHA_ARM_TARGET
+  static void processBlocksArm(uint32_t state[5], const uint8_t *data, size_t blocks) {
+    static const uint32_t constants[4] = {0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6};
+
+    uint32x4_t abcd = vld1q_u32(state);
+    uint32_t e = state[4];
+
+    for(; blocks; blocks--, data += 64) {
+      const uint32x4_t abcdSaved = abcd;
+      const uint32_t eSaved = e;
+
+      uint32x4_t w[4];
+      for(int i = 0; i < 4; i++) {
+        w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+      }
+
+      // four rounds per step, the schedule for step k+4 is computed right after step k used its words
+      for(int k = 0; k < 20; k++) {
+        const uint32x4_t wk = vaddq_u32(w[k & 3], vdupq_n_u32(constants[k / 5]));
+        const uint32_t nextE = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        if(k < 5) abcd = vsha1cq_u32(abcd, e, wk);
+        else if(k >= 10 && k < 15) abcd = vsha1mq_u32(abcd, e, wk);
+        else abcd = vsha1pq_u32(abcd, e, wk);
+        e = nextE;
+
+        if(k < 16) {
+          w[k & 3] = vsha1su1q_u32(vsha1su0q_u32(w[k & 3], w[(k + 1) & 3], w[(k + 2) & 3]), w[(k + 3) & 3]);
+        }
+      }
+
+      abcd = vaddq_u32(abcd, abcdSaved);
+      e += eSaved;
+    }
+
+    vst1q_u32(state, abcd);
+    state[4] = e;
+  }
+
+  #undef SHA_ARM_TARGET
+
+  static bool hasArmSha1() {
+  #if defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_SHA1) != 0;
+  #else
+    // only built when the compiler targets the crypto extensions (e.g. every Apple arm64 cpu)
+    return true;
+  #endif
+  }
+#endif // _WS_SHA1_ARM
+
+  // the cpu is only inspected once, on the first hash
+  static BlockFunction selectBlockFunction() {
+#ifdef _WS_SHA1_X86
+    if(hasShaNi()) return &processBlocksShaNi;
+#endif
+#ifdef _WS_SHA1_ARM
+    if(hasArmSha1()) return &processBlocksArm;
+#endif
+    return &processBlocksPortable;
+  }
+
+  static BlockFunction blockFunction() {
+    static const BlockFunction selected = selectBlockFunction();
+    return selected;
+  }
+
+  void sha1_process_blocks(uint32_t state[5], const uint8_t *data, size_t blocks) {
+    blockFunction()(state, data, blocks);
+  }
+
+  void sha1_process_blocks_x2(
+      uint32_t first_state[5], const uint8_t *first_data,
+      uint32_t second_state[5], const uint8_t *second_data,
+      size_t blocks) {
+    const BlockFunction function = blockFunction();
+#ifdef _WS_SHA1_X86
+    if(function == &processBlocksShaNi) {
+      processBlocksShaNiX2(first_state, first_data, second_state, second_data, blocks);
+      return;
+    }
+#endif
+    function(first_state, first_data, blocks);
+    function(second_state, second_data, blocks);
+  }
+}}} // websockets::crypto::internals
@@ -0,0 +1,317 @@
+#include <tiny_websockets/static_client.hpp>
+#include <tiny_websockets/internals/handshake_parser.hpp>
+#include <tiny_websockets/internals/websockets_endpoint_impl.hpp>
+#include <tiny_websockets/internals/wscrypto/crypto.hpp>
+
+namespace websockets { namespace internals {
+    StaticWebsocketsEndpoint::StaticWebsocketsEndpoint(char* receiveBuffer, const size_t receiveCapacity,
+                                                       char* messageBuffer, const size_t maxMessageSize,
+                                                       char* sendBuffer, const size_t sendCapacity) :
+        _transport(nullptr), _connectionOpen(false), _closeReason(CloseReason_None),
+        _receiveBuffer(receiveBuffer), _receiveCapacity(receiveCapacity),
+        _messageBuffer(messageBuffer), _maxMessageSize(maxMessageSize), _messageLength(0), _messageType(MessageType::Empty),
+        _sendBuffer(sendBuffer), _sendCapacity(sendCapacity),
+        _messageCallback(nullptr), _messageContext(nullptr), _eventCallback(nullptr), _eventContext(nullptr) {
+        // Empty
+    }
+
+    // Appends to a fixed buffer, remembering if anything didn't fit
+    class BoundedWriter {
+    public:
+        BoundedWriter(char* buffer, size_t capacity) : _buffer(buffer), _capacity(capacity), _size(0), _overflow(false) {}
+
+        BoundedWriter& add(const char* data, size_t len) {
+            if(len > this->_capacity - this->_size) {
+                this->_overflow = true;
+                return *this;
+            }
+            memcpy(this->_buffer + this->_size, data, len);
+            this->_size += len;
+            return *this;
+        }
+        BoundedWriter& add(const char* str) { return add(str, strlen(str)); }
+
+        char* end() { return this->_buffer + this->_size; }
+        size_t size() const { return this->_size; }
+        bool overflowed() const { return this->_overflow; }
+
+    private:
+        char* _buffer;
+        size_t _capacity;
+        size_t _size;
+        bool _overflow;
+    };
+
+    // 16 random bytes, base64 encoded
+    #define STATIC_HANDSHAKE_KEY_SIZE 24
+
+    bool StaticWebsocketsEndpoint::connect(network::TcpClient& transport, const char* host, const char* path) {
+        this->_transport = &transport;
+        this->_connectionOpen = false;
+        this->_closeReason = CloseReason_None;
+        this->_messageLength = 0;
+        this->_messageType = MessageType::Empty;
+        if(!transport.available()) return false;
+
+        char key[STATIC_HANDSHAKE_KEY_SIZE];
+        uint8_t nonce[16];
+        crypto::randomFill(nonce, sizeof(nonce));
+        crypto::base64Encode(nonce, sizeof(nonce), key);
+
+        BoundedWriter request(this->_sendBuffer, this->_sendCapacity);
+        request.add("GET ").add(path).add(" HTTP/1.1\r\nHost: ").add(handshakeHost(host));
+        request.add("\r\nSec-WebSocket-Key: ").add(key, sizeof(key))
+               .add("\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\n\r\n");
+        if(request.overflowed()) {
+            transport.close();
+            return false;
+        }
+        transport.send(reinterpret_cast<const uint8_t*>(this->_sendBuffer), request.size());
+
+        // byte by byte, so nothing that follows the headers (a first frame) is consumed with them
+        BoundedWriter response(this->_receiveBuffer, this->_receiveCapacity);
+        while(transport.available()) {
+            char ch;
+            if(readUntilSuccessfullOrError(transport, reinterpret_cast<uint8_t*>(&ch), 1) != 1) break;
+            response.add(&ch, 1);
+            if(response.overflowed()) break;
+
+            if(response.size() >= 4 && memcmp(response.end() - 4, "\r\n\r\n", 4) == 0) {
+                char expectedAccept[SHA1_BASE64_SIZE];
+                crypto::websocketsHandshakeEncodeKey(key, sizeof(key), expectedAccept);
+
+                HandshakeHeaders headers;
+                this->_connectionOpen = parseHandshakeHeaders(this->_receiveBuffer, response.size(), headers) &&
+                                        isValidUpgradeResponse(headers, expectedAccept);
+                break;
+            }
+        }
+
+        if(!this->_connectionOpen) {
+            transport.close();
+            return false;
+        }
+        dispatchEvent(WebsocketsEvent::ConnectionOpened, nullptr, 0);
+        return true;
+    }
+
+    bool StaticWebsocketsEndpoint::available() {
+        if(this->_connectionOpen && !this->_transport->available()) {
+            connectionLost();
+        }
+        return this->_connectionOpen;
+    }
+
+    bool StaticWebsocketsEndpoint::poll() {
+        bool delivered = false;
+        while(available() && this->_transport->poll()) {
+            delivered |= readFrame();
+        }
+        return delivered;
+    }
+
+    // Reads one frame, data frames are aggregated in the message buffer and delivered on their last fragment
+    bool StaticWebsocketsEndpoint::readFrame() {
+        network::TcpClient& transport = *this->_transport;
+
+        auto header = readHeaderFromSocket(transport);
+        if(!transport.available()) return false;
+        uint64_t payloadLength = readExtendedPayloadLength(transport, header);
+        if(!transport.available()) return false;
+
+        uint8_t maskingKey[4];
+        if(header.mask) {
+            readMaskingKey(transport, maskingKey);
+            if(!transport.available()) return false;
+        }
+
+        if(header.opcode & 0x8) {
+            // control frames can't be longer than 125 bytes (RFC 6455 5.5)
+            if(payloadLength > 125 || !header.fin) {
+                close(CloseReason_ProtocolError);
+                return false;
+            }
+            const size_t len = static_cast<size_t>(payloadLength);
+            if(len > 0 && readUntilSuccessfullOrError(transport, reinterpret_cast<uint8_t*>(this->_receiveBuffer), len) != len) return false;
+            if(header.mask) applyMask(reinterpret_cast<uint8_t*>(this->_receiveBuffer), len, maskingKey, 0);
+
+            handleControlFrame(header.opcode, len);
+            return false;
+        }
+
+        // a continuation adds to the message being built, anything else starts a new one
+        const bool continuation = header.opcode == ContentType::Continuation;
+        const bool knownOpcode = continuation || header.opcode == ContentType::Text || header.opcode == ContentType::Binary;
+        if(!knownOpcode || continuation != (this->_messageType != MessageType::Empty)) {
+            close(CloseReason_ProtocolError);
+            return false;
+        }
+        if(!continuation) {
+            this->_messageType = messageTypeFromOpcode(header.opcode);
+            this->_messageLength = 0;
+        }
+        if(payloadLength > this->_maxMessageSize - this->_messageLength) {
+            close(CloseReason_MessageTooBig);
+            return false;
+        }
+
+        const size_t len = static_cast<size_t>(payloadLength);
+        uint8_t* payload = reinterpret_cast<uint8_t*>(this->_messageBuffer + this->_messageLength);
+        size_t done = 0;
+        while(done < len && transport.available()) {
+            // reads are chunked like WebsocketsEndpoint's, so platforms without blocking reads can yield
+            const size_t chunk = len - done < _WS_BUFFER_SIZE ? len - done : _WS_BUFFER_SIZE;
+            done += readUntilSuccessfullOrError(transport, payload + done, chunk);
+        }
+        if(done < len) return false;
+        if(header.mask) applyMask(payload, len, maskingKey, 0);
+        this->_messageLength += len;
+
+        if(!header.fin) return false;
+
+        const MessageType type = this->_messageType;
+        this->_messageType = MessageType::Empty;
+        this->_messageBuffer[this->_messageLength] = '\0';
+        if(this->_messageCallback) {
+            this->_messageCallback(this->_messageContext, type, this->_messageBuffer, this->_messageLength);
+        }
+        return true;
+    }
+
+    void StaticWebsocketsEndpoint::handleControlFrame(const uint8_t opcode, const size_t len) {
+        this->_receiveBuffer[len] = '\0';
+
+        if(opcode == ContentType::Ping) {
+            pong(this->_receiveBuffer, len);
+            dispatchEvent(WebsocketsEvent::GotPing, this->_receiveBuffer, len);
+        } else if(opcode == ContentType::Pong) {
+            dispatchEvent(WebsocketsEvent::GotPong, this->_receiveBuffer, len);
+        } else if(opcode == ContentType::Close) {
+            // is there a reason field
+            CloseReason reason = CloseReason_GoingAway;
+            if(len >= 2) {
+                const uint8_t* code = reinterpret_cast<const uint8_t*>(this->_receiveBuffer);
+                reason = GetCloseReason(static_cast<uint16_t>((code[0] << 8) | code[1]));
+            }
+            close(reason);
+        } else {
+            close(CloseReason_ProtocolError);
+        }
+    }
+
+    // Client frames are always masked, the payload goes through the send buffer a chunk at a time
+    bool StaticWebsocketsEndpoint::sendFrame(const uint8_t opcode, const char* data, const size_t len) {
+        if(!available()) return false;
+
+        uint8_t* buffer = reinterpret_cast<uint8_t*>(this->_sendBuffer);
+        size_t headerSize = 2;
+        buffer[0] = 0x80 | opcode;
+        if(len < 126) {
+            buffer[1] = 0x80 | static_cast<uint8_t>(len);
+        } else if(len < 65536) {
+            buffer[1] = 0x80 | 126;
+            buffer[2] = static_cast<uint8_t>(len >> 8);
+            buffer[3] = static_cast<uint8_t>(len);
+            headerSize = 4;
+        } else {
+            buffer[1] = 0x80 | 127;
+            const uint64_t len64 = len;
+            for(int i = 0; i < 8; i++) {
+                buffer[2 + i] = static_cast<uint8_t>(len64 >> ((7 - i) * 8));
+            }
+            headerSize = 10;
+        }
+
+        uint8_t maskingKey[4];
+        crypto::randomFill(maskingKey, 4);
+        memcpy(buffer + headerSize, maskingKey, 4);
+        headerSize += 4;
+
+        // the first chunk shares the buffer with the header
+        size_t done = 0;
+        size_t offset = headerSize;
+        do {
+            size_t chunk = this->_sendCapacity - offset;
+            if(chunk > len - done) chunk = len - done;
+
+            // empty pings and pongs have no data to copy
+            if(chunk != 0) memcpy(buffer + offset, data + done, chunk);
+            applyMask(buffer + offset, chunk, maskingKey, done);
+            this->_transport->send(buffer, static_cast<uint32_t>(offset + chunk));
+            done += chunk;
+            offset = 0;
+        } while(done < len && this->_transport->available());
+
+        return done == len && this->_transport->available();
+    }
+
+    bool StaticWebsocketsEndpoint::send(const char* data, const size_t len) {
+        return sendFrame(ContentType::Text, data, len);
+    }
+
+    bool StaticWebsocketsEndpoint::sendBinary(const char* data, const size_t len) {
+        return sendFrame(ContentType::Binary, data, len);
+    }
+
+    bool StaticWebsocketsEndpoint::ping(const char* data, const size_t len) {
+        // Ping data must be shorter than 125 bytes
+        if(len > 125) return false;
+        return sendFrame(ContentType::Ping, data, len);
+    }
+
+    bool StaticWebsocketsEndpoint::pong(const char* data, const size_t len) {
+        // Pong data must be shorter than 125 bytes
+        if(len > 125) return false;
+        return sendFrame(ContentType::Pong, data, len);
+    }
+
+    void StaticWebsocketsEndpoint::close(const CloseReason reason) {
+        if(!this->_connectionOpen) return;
+        this->_closeReason = reason;
+
+        if(this->_transport->available()) {
+            if(reason == CloseReason_None) {
+                sendFrame(ContentType::Close, nullptr, 0);
+            } else {
+                const char code[2] = {
+                    static_cast<char>(static_cast<uint16_t>(reason) >> 8),
+                    static_cast<char>(static_cast<uint16_t>(reason) & 0xFF)
+                };
+                sendFrame(ContentType::Close, code, 2);
+            }
+            this->_transport->close();
+        }
+
+        this->_connectionOpen = false;
+        this->_messageType = MessageType::Empty;
+        dispatchEvent(WebsocketsEvent::ConnectionClosed, nullptr, 0);
+    }
+
+    // the transport went away without a close frame
+    void StaticWebsocketsEndpoint::connectionLost() {
+        this->_connectionOpen = false;
+        this->_messageType = MessageType::Empty;
+        if(this->_closeReason == CloseReason_None) this->_closeReason = CloseReason_AbnormalClosure;
+        dispatchEvent(WebsocketsEvent::ConnectionClosed, nullptr, 0);
+    }
+
+    CloseReason StaticWebsocketsEndpoint::getCloseReason() const {
+        return this->_closeReason;
+    }
+
+    void StaticWebsocketsEndpoint::onMessage(const StaticMessageCallback callback, void* context) {
+        this->_messageCallback = callback;
+        this->_messageContext = context;
+    }
+
+    void StaticWebsocketsEndpoint::onEvent(const StaticEventCallback callback, void* context) {
+        this->_eventCallback = callback;
+        this->_eventContext = context;
+    }
+
+    void StaticWebsocketsEndpoint::dispatchEvent(const WebsocketsEvent event, const char* data, const size_t len) {
+        if(this->_eventCallback) {
+            this->_eventCallback(this->_eventContext, event, data ? data : "", len);
+        }
+    }
+}} // websockets::internals
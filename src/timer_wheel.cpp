@@ -0,0 +1,125 @@
+#include <tiny_websockets/internals/timer_wheel.hpp>
+
+namespace websockets { namespace internals {
+    void pushFront(TimerNode*& head, TimerNode& timer) {
+        timer.next = head;
+        if(head) head->pprev = &timer.next;
+        head = &timer;
+        timer.pprev = &head;
+    }
+
+    // Moves a whole slot into a local list. Timers are then popped one by one, so callbacks
+    // can safely cancel any other timer (including ones in the detached list)
+    void detachList(TimerNode*& from, TimerNode*& to) {
+        to = from;
+        from = nullptr;
+        if(to) to->pprev = &to;
+    }
+
+    void TimerNode::cancel() {
+        if(!isScheduled()) return;
+
+        *this->pprev = this->next;
+        if(this->next) this->next->pprev = this->pprev;
+        this->next = nullptr;
+        this->pprev = nullptr;
+    }
+
+    void TimerNode::transferTo(TimerNode& other) {
+        if(&other == this) return;
+        other.cancel();
+        if(!isScheduled()) return;
+
+        other.next = this->next;
+        other.pprev = this->pprev;
+        other.expiry = this->expiry;
+        *other.pprev = &other;
+        if(other.next) other.next->pprev = &other.next;
+
+        this->next = nullptr;
+        this->pprev = nullptr;
+    }
+
+    TimerWheel::TimerWheel(const unsigned long nowMillis) : _currentTick(0), _lastTickMillis(nowMillis) {
+        for(size_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+            for(size_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+                this->_slots[level][slot] = nullptr;
+            }
+        }
+    }
+
+    void TimerWheel::schedule(TimerNode& timer, const unsigned long delayMillis) {
+        timer.cancel();
+
+        unsigned long ticks = (delayMillis + TIMER_WHEEL_TICK_MILLIS - 1) / TIMER_WHEEL_TICK_MILLIS;
+        if(ticks == 0) ticks = 1;
+
+        timer.expiry = this->_currentTick + ticks;
+        insert(timer);
+    }
+
+    void TimerWheel::insert(TimerNode& timer) {
+        const unsigned long maxDelta = (1UL << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+        if(timer.expiry - this->_currentTick > maxDelta) {
+            // clamped to the furthest the wheel can hold (about 19 days with 100ms ticks)
+            timer.expiry = this->_currentTick + maxDelta;
+        }
+
+        const unsigned long delta = timer.expiry - this->_currentTick;
+        size_t level = 0;
+        while(level < TIMER_WHEEL_LEVELS - 1 && delta >= (1UL << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+
+        const size_t slot = (timer.expiry >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+        pushFront(this->_slots[level][slot], timer);
+    }
+
+    void TimerWheel::tick(TimerCallback callback, void* arg) {
+        this->_currentTick++;
+
+        // when a level wraps around, the matching slot of the level above is spread into the lower levels
+        for(size_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if(((this->_currentTick >> (TIMER_WHEEL_SLOT_BITS * (level - 1))) & (TIMER_WHEEL_SLOTS - 1)) != 0) break;
+
+            const size_t slot = (this->_currentTick >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+            TimerNode* cascaded;
+            detachList(this->_slots[level][slot], cascaded);
+            while(cascaded) {
+                TimerNode& timer = *cascaded;
+                timer.cancel();
+                insert(timer);
+            }
+        }
+
+        TimerNode* expired;
+        detachList(this->_slots[0][this->_currentTick & (TIMER_WHEEL_SLOTS - 1)], expired);
+        while(expired) {
+            TimerNode& timer = *expired;
+            timer.cancel();
+            if(timer.expiry == this->_currentTick) {
+                callback(timer, arg);
+            } else {
+                insert(timer);
+            }
+        }
+    }
+
+    void TimerWheel::advance(const unsigned long nowMillis, TimerCallback callback, void* arg) {
+        while(nowMillis - this->_lastTickMillis >= TIMER_WHEEL_TICK_MILLIS) {
+            this->_lastTickMillis += TIMER_WHEEL_TICK_MILLIS;
+            tick(callback, arg);
+        }
+    }
+
+    TimerWheel::~TimerWheel() {
+        // timers may outlive the wheel, leave them unscheduled
+        for(size_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+            for(size_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+                while(this->_slots[level][slot]) {
+                    this->_slots[level][slot]->cancel();
+                }
+            }
+        }
+    }
+}} // websockets::internals
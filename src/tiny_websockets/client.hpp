@@ -4,6 +4,7 @@
 #include <tiny_websockets/network/tcp_client.hpp>
 #include <tiny_websockets/internals/data_frame.hpp>
 #include <tiny_websockets/internals/websockets_endpoint.hpp>
+#include <tiny_websockets/internals/timer_wheel.hpp>
 #include <tiny_websockets/message.hpp>
 #include <memory>
 #include <functional>
@@ -13,6 +14,7 @@ namespace websockets {
   enum class WebsocketsEvent {
     ConnectionOpened,
     ConnectionClosed,
+    ConnectionFailed, // an async connect (see `connectAsync`) didn't make it to an open connection
     GotPing, GotPong
   };
 
@@ -23,22 +25,55 @@ namespace websockets {
     typedef std::function<void(WebsocketsClient&, WebsocketsEvent, WSInterfaceString)> EventCallback;
     typedef std::function<void(WebsocketsEvent, WSInterfaceString)> PartialEventCallback;
 
+  // Limits the work done by a single `poll` call, so one busy connection can't starve the others.
+  // A value of 0 means unlimited
+  struct PollBudget {
+    PollBudget(const size_t messages = 0, const size_t bytes = 0, const unsigned long millis = 0) :
+      maxMessages(messages), maxBytes(bytes), maxMillis(millis) {}
+
+    size_t maxMessages;
+    size_t maxBytes;
+    unsigned long maxMillis;
+  };
+
   class WebsocketsClient {
   public:
     WebsocketsClient();
     WebsocketsClient(std::shared_ptr<network::TcpClient> client);
     
-    WebsocketsClient(const WebsocketsClient& other);
-    WebsocketsClient(const WebsocketsClient&& other);
+    // A client owns its connection: it can be moved (ex. `clients[i] = std::move(client)`) but not copied.
+    // A moved-from client is not connected, connecting it again gives it a new default transport
+    WebsocketsClient(const WebsocketsClient& other) = delete;
+    WebsocketsClient(WebsocketsClient&& other) noexcept;
     
-    WebsocketsClient& operator=(const WebsocketsClient& other);
-    WebsocketsClient& operator=(const WebsocketsClient&& other);
+    WebsocketsClient& operator=(const WebsocketsClient& other) = delete;
+    WebsocketsClient& operator=(WebsocketsClient&& other) noexcept;
 
     void addHeader(const WSInterfaceString key, const WSInterfaceString value);
 
+    // ws://, wss:// (unless _WS_CONFIG_NO_SSL) and, on linux, ws+unix://<socket path>[:<request path>]
     bool connect(const WSInterfaceString url);
     bool connect(const WSInterfaceString host, const int port, const WSInterfaceString path);
     bool connectSecure(const WSInterfaceString host, const int port, const WSInterfaceString path);
+
+    // Non-blocking connect: resolving the host (on linux), the TCP connect and the handshake are advanced
+    // by `poll`, which then fires either `ConnectionOpened` or `ConnectionFailed`. Returns false if the
+    // connect could not be started
+    bool connectAsync(const WSInterfaceString url);
+    bool connectAsync(const WSInterfaceString host, const int port, const WSInterfaceString path);
+    // deadlines for the TCP connect (resolving included) and for the handshake response, for async connects
+    void setConnectTimeouts(const unsigned long connectMillis, const unsigned long handshakeMillis);
+    bool isConnecting() const;
+    // Reconnects (from `poll`) whenever the connection is lost, waiting between attempts with an
+    // exponential backoff (with jitter) from `minDelayMillis` up to `maxDelayMillis`. 0 disables it.
+    // An explicit `close` stops reconnecting until the next connect
+    void setAutoReconnect(const unsigned long minDelayMillis, const unsigned long maxDelayMillis = 30000);
+
+    // Keeps a second, already upgraded, connection to `url` (can be the same url) idle in the background,
+    // pinged every `keepAliveMillis`. When the primary connection closes, the client switches to it without
+    // a closed event and starts a new standby. An empty url disables it.
+    // The standby connects with the client's TLS settings, custom headers and timeouts, and is driven by `poll`
+    void setStandby(const WSInterfaceString url, const unsigned long keepAliveMillis = 15000);
       
     void onMessage(const MessageCallback callback);
     void onMessage(const PartialMessageCallback callback);
@@ -47,6 +82,9 @@ namespace websockets {
     void onEvent(const PartialEventCallback callback);
 
     bool poll();
+    void setPollBudget(const PollBudget& budget);
+    // true when the last `poll` stopped because of the budget while more data was waiting
+    bool hasPendingWork() const;
     bool available(const bool activeTest = false);
 
     bool send(const WSInterfaceString&& data);
@@ -56,6 +94,10 @@ namespace websockets {
 
     bool sendBinary(const WSInterfaceString data);
     bool sendBinary(const char* data, const size_t len);
+  #ifdef __linux__
+    // sends `len` bytes of the open file `fd` (from `offset`) as one binary message, see WebsocketsEndpoint::sendFile
+    bool sendBinaryFile(int fd, const uint64_t len, const uint64_t offset = 0);
+  #endif
 
     // stream messages
     bool stream(const WSInterfaceString data = "");
@@ -64,6 +106,21 @@ namespace websockets {
     
     void setFragmentsPolicy(const FragmentsPolicy newPolicy);
     FragmentsPolicy getFragmentsPolicy() const;
+
+    // Checks that received text messages are valid UTF-8, the connection is closed with
+    // CloseReason_InvalidPayloadData (1007) when they aren't. Off by default
+    void setUtf8Validation(const bool validate);
+
+    // Limits on received frames, messages and buffered bytes (0 means unlimited). Checked from the frame
+    // header, before the payload is allocated. Exceeding one closes with CloseReason_MessageTooBig (1009)
+    void setSizeLimits(const size_t maxFrameSize, const size_t maxMessageSize, const size_t maxBufferedBytes = 0);
+
+  #ifdef __linux__
+    // Aggregated messages growing over `thresholdBytes` (0 disables) are written to an unlinked temporary
+    // file in `directory` instead of memory. They are delivered as a read-only mapping: use `c_str()` and
+    // `length()`, `data()` and `rawData()` would copy them back into memory
+    void setMessageSpill(const size_t thresholdBytes, const char* directory = "/tmp");
+  #endif
     
     WebsocketsMessage readBlocking();
 
@@ -84,45 +141,85 @@ namespace websockets {
 	void setClientECCert(const X509List *cert, const PrivateKey *sk);
     void setTrustAnchors(const X509List *ta);
 	void setKnownKey(const PublicKey *pk);
-  #elif defined(ESP32)
+  #elif defined(ESP32) || defined(__linux__)
     void setCACert(const char* ca_cert);
     void setCertificate(const char* client_ca);
     void setPrivateKey(const char* private_key);
   #endif
+  #ifdef __linux__
+    // offload TLS record encryption to the kernel (kTLS) for wss connections, see SecuredLinuxTcpClient::setKernelTls
+    void setKernelTls(const bool enable);
+  #endif
 
     virtual ~WebsocketsClient();
 
   private:
+    // hot: used by every poll and send
     std::shared_ptr<network::TcpClient> _client;
-    std::vector<std::pair<WSString, WSString>> _customHeaders;
     internals::WebsocketsEndpoint _endpoint;
     bool _connectionOpen;
-    MessageCallback _messagesCallback;
-    EventCallback _eventsCallback;
     enum SendMode {
       SendMode_Normal,
       SendMode_Streaming
     } _sendMode;
-
-
-  #ifdef ESP8266
-    const char* _optional_ssl_fingerprint = nullptr;
-    const X509List* _optional_ssl_trust_anchors = nullptr;
-	const PublicKey* _optional_ssl_known_key = nullptr;
-    const X509List* _optional_ssl_rsa_cert = nullptr;
-    const PrivateKey* _optional_ssl_rsa_private_key = nullptr;
-	const X509List* _optional_ssl_ec_cert = nullptr;
-    const PrivateKey* _optional_ssl_ec_private_key = nullptr;
-  #elif defined(ESP32)
-    const char* _optional_ssl_ca_cert = nullptr;
-    const char* _optional_ssl_client_ca = nullptr;
-    const char* _optional_ssl_private_key = nullptr;
-  #endif
+    bool _hasPendingWork;
+    PollBudget _pollBudget;
+
+    // Shared with the server that accepted this client (see WebsocketsServer::onMessage) instead of
+    // being copied into every client, replaced (never modified) when `onMessage` or `onEvent` is called
+    struct Callbacks {
+      MessageCallback messages;
+      EventCallback events;
+    };
+    std::shared_ptr<const Callbacks> _callbacks;
+    static std::shared_ptr<const Callbacks> defaultCallbacks();
+
+    // keep alive state, driven by the server that accepted this client (see WebsocketsServer::setKeepAlive)
+    struct KeepAlive {
+      internals::TimerNode timer;
+      unsigned long delayMillis = 0;
+      unsigned long idleMillis = 0;
+      bool gotMessage = false;
+      bool gotData = false;
+      bool awaitingPong = false;
+    } _keepAlive;
+    friend class WebsocketsServer;
+
+    void takeKeepAlive(WebsocketsClient& other);
+
+    // state of an async connect, only allocated while one is in progress
+    struct PendingConnect;
+    std::unique_ptr<PendingConnect> _pendingConnect;
+
+    // cold: the state of connections opened by this client (target, custom headers, handshake template,
+    // timeouts, reconnect, standby and TLS settings). Clients accepted by a server never need it, so it
+    // is only allocated by the first call that does
+    struct Outbound;
+    std::unique_ptr<Outbound> _outbound;
+    Outbound& outbound();
+
+    void advanceConnect();
+    void failConnect(const char* reason);
+    bool beginConnectAttempt();
+
+    void setTarget(const WSString& host, const int port, const WSString& path);
+    WSString prepareHandshake();
+
+    void scheduleReconnect();
+    void reconnectIfDue();
+    void closeConnection(const CloseReason reason);
+
+    void pollStandby();
+    bool failoverToStandby();
 
     void _handlePing(WebsocketsMessage);
     void _handlePong(WebsocketsMessage);
     void _handleClose(WebsocketsMessage);
 
     void upgradeToSecuredConnection();
+    // a moved-from client has no transport left, connects give it a default one
+    void ensureTransport();
+    // switches to an AF_UNIX transport, for ws+unix:// urls (linux only)
+    void useUnixSocket();
   };
 }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <memory>
+
+namespace websockets { namespace internals {
+    // The storage of a few payload buffers of a connection (up to _WS_BUFFER_POOL_MAX_SIZE bytes each),
+    // so received frames and outgoing frames reuse it instead of going back to the heap every time
+    class BufferPool {
+    public:
+        BufferPool() {}
+
+        // the cached buffers follow the connection that owns them
+        BufferPool(BufferPool&& other) = default;
+        BufferPool& operator=(BufferPool&& other) = default;
+
+        // an empty buffer with room for at least `capacity` bytes
+        WSString take(const size_t capacity);
+        // keeps the storage of `buffer` for a later `take`, when it is worth keeping
+        void give(WSString&& buffer);
+        // frees every cached buffer (and the slots)
+        void clear();
+
+    private:
+#if _WS_BUFFER_POOL_SLOTS > 0
+        // _WS_BUFFER_POOL_SLOTS strings, only allocated once there is a buffer to keep
+        std::unique_ptr<WSString[]> _buffers;
+#endif
+    };
+}} // websockets::internals
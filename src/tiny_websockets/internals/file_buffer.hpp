@@ -0,0 +1,35 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <tiny_websockets/internals/ws_common.hpp>
+
+namespace websockets { namespace internals {
+    // A payload kept in an unlinked temporary file instead of the heap. It is written sequentially,
+    // then mapped read-only with a null byte after it (so the mapping can be used as a C string)
+    class FileBuffer {
+    public:
+        FileBuffer() : _fd(-1), _size(0), _mapping(nullptr) {}
+
+        FileBuffer(const FileBuffer& other) = delete;
+        FileBuffer& operator=(const FileBuffer& other) = delete;
+
+        // creates the file in `directory`, nothing else is visible there
+        bool open(const char* directory);
+        bool append(const char* data, const size_t len);
+        // nothing can be appended once mapped
+        bool map();
+
+        const char* data() const { return this->_mapping; }
+        size_t size() const { return this->_size; }
+
+        ~FileBuffer();
+
+    private:
+        int _fd;
+        size_t _size;
+        char* _mapping;
+    };
+}} // websockets::internals
+
+#endif // #ifdef __linux__
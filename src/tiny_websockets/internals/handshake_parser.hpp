@@ -0,0 +1,48 @@
+#pragma once
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/tcp_client.hpp>
+
+namespace websockets { namespace internals {
+    // A non-owning view into a handshake buffer
+    struct StringView {
+        const char* data;
+        size_t size;
+
+        StringView() : data(nullptr), size(0) {}
+        StringView(const char* str, size_t len) : data(str), size(len) {}
+
+        bool empty() const { return size == 0; }
+        WSString str() const { return WSString(data, size); }
+
+        bool equals(const char* other) const;
+        bool equalsIgnoreCase(const char* other) const;
+        bool startsWith(const char* prefix) const;
+
+        // checks for `token` in a comma separated header value (ex. "keep-alive, Upgrade")
+        bool containsTokenIgnoreCase(const char* token) const;
+    };
+
+    // Only the headers that matter for the upgrade are kept, all other headers are skipped
+    struct HandshakeHeaders {
+        StringView firstLine; // request line (server side) or status line (client side)
+        StringView upgrade;
+        StringView connection;
+        StringView secWebSocketKey;
+        StringView secWebSocketVersion;
+        StringView secWebSocketAccept;
+    };
+
+    // Reads the first line and all the header lines (including the terminating empty line) into `buffer`
+    bool readHandshakeHeaders(network::TcpClient& client, WSString& buffer);
+
+    // Single pass over a complete header block. The resulting views point into `buffer`
+    bool parseHandshakeHeaders(const char* buffer, const size_t len, HandshakeHeaders& result);
+
+    // Checks the parsed response of a server: "101 Switching Protocols", the upgrade headers and
+    // the accept key of our request (unless _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION is defined)
+    bool isValidUpgradeResponse(const HandshakeHeaders& headers, const char* expectedAcceptKey);
+
+    // The Host header value of a request to `host`: a unix socket path ("/..." or "@...") is not a valid Host
+    const char* handshakeHost(const char* host);
+}} // websockets::internals
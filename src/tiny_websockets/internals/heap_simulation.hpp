@@ -0,0 +1,30 @@
+#pragma once
+
+#if defined(__linux__) && defined(_WS_CONFIG_SIMULATE_HEAP)
+
+#include <tiny_websockets/internals/ws_common.hpp>
+
+namespace websockets { namespace internals {
+    // Host builds with _WS_CONFIG_SIMULATE_HEAP defined to a size in bytes (ex. -D_WS_CONFIG_SIMULATE_HEAP=40960)
+    // replace the global operator new/delete with a fixed arena of that size and a first-fit allocator,
+    // so allocation patterns that fragment a small device heap show up on the host.
+    // Every block costs a header (alignof(max_align_t) bytes) and is rounded up to that alignment.
+    // Allocations that don't fit are counted as failures and served from the system heap, so a long
+    // session keeps running and reports all of them
+    struct HeapStats {
+        size_t capacity;
+        // bytes taken by live blocks (headers included), and the most that was ever taken
+        size_t used;
+        size_t peakUsed;
+        // the largest allocation that would currently succeed
+        size_t largestFreeBlock;
+        size_t allocations;
+        size_t failures;
+    };
+
+    HeapStats getHeapStats();
+    // starts measuring the peak again from the current usage
+    void resetHeapPeak();
+}} // websockets::internals
+
+#endif // #if defined(__linux__) && defined(_WS_CONFIG_SIMULATE_HEAP)
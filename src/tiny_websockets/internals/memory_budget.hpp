@@ -0,0 +1,81 @@
+#pragma once
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <memory>
+#include <vector>
+
+namespace websockets { namespace internals {
+    class MemoryBudget;
+
+    // The bytes a single connection holds against a MemoryBudget (frames being read and fragments
+    // being aggregated). The connection reads nothing while paused, and closes itself when asked to
+    class MemoryAccount {
+    public:
+        MemoryAccount(std::shared_ptr<MemoryBudget> budget);
+
+        MemoryAccount(const MemoryAccount& other) = delete;
+        MemoryAccount& operator=(const MemoryAccount& other) = delete;
+
+        // adds `bytes` about to be allocated
+        void charge(const size_t bytes);
+        // the connection now holds exactly `bytes`
+        void settle(const size_t bytes);
+        // for a new connection: nothing is held and no close is pending
+        void release();
+
+        size_t charged() const { return this->_charged; }
+        bool isPaused() const { return this->_paused; }
+        bool isCloseRequested() const { return this->_closeRequested; }
+
+        ~MemoryAccount();
+
+    private:
+        std::shared_ptr<MemoryBudget> _budget;
+        size_t _charged;
+        bool _paused;
+        bool _closeRequested;
+        // position in the budget's list of accounts
+        size_t _index;
+
+        friend class MemoryBudget;
+    };
+
+    // Server wide accounting of received payloads. Over `limit`, reads from the largest consumers are
+    // paused (and those connections are asked to close, if `closeLargest` is set) until what they hold
+    // would bring the usage down to `lowWatermark`. Everyone resumes once the usage is below it.
+    // A frame that is already being read is always completed, and when only paused connections hold
+    // memory the smallest of them is resumed, so its message can complete
+    class MemoryBudget {
+    public:
+        MemoryBudget(const size_t limit, const size_t lowWatermark, const bool closeLargest);
+
+        MemoryBudget(const MemoryBudget& other) = delete;
+        MemoryBudget& operator=(const MemoryBudget& other) = delete;
+
+        size_t used() const { return this->_used; }
+        size_t limit() const { return this->_limit; }
+        size_t lowWatermark() const { return this->_lowWatermark; }
+
+    private:
+        size_t _limit;
+        size_t _lowWatermark;
+        bool _closeLargest;
+        bool _throttling;
+        size_t _used;
+        // held by accounts that are not paused
+        size_t _activeUsed;
+        std::vector<MemoryAccount*> _accounts;
+
+        void add(MemoryAccount& account);
+        void remove(MemoryAccount& account);
+        void adjust(MemoryAccount& account, const size_t charged);
+
+        void pause(MemoryAccount& account);
+        void resume(MemoryAccount& account);
+        void throttle();
+        void resumeAll();
+        void resumeSmallest();
+
+        friend class MemoryAccount;
+    };
+}} // websockets::internals
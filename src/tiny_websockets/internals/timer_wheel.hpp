@@ -0,0 +1,53 @@
+#pragma once
+
+#include <tiny_websockets/internals/ws_common.hpp>
+
+#define TIMER_WHEEL_TICK_MILLIS 100
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+namespace websockets { namespace internals {
+    // An intrusive timer, embedded in the object it belongs to (so scheduling never allocates)
+    struct TimerNode {
+        TimerNode() : next(nullptr), pprev(nullptr), expiry(0), context(nullptr) {}
+
+        TimerNode* next;
+        TimerNode** pprev; // nullptr while not scheduled
+        unsigned long expiry; // in ticks
+        void* context;
+
+        bool isScheduled() const { return pprev != nullptr; }
+        void cancel();
+        // moves the scheduling of this timer to `other`, for when the owning object is moved
+        void transferTo(TimerNode& other);
+    };
+
+    // Hierarchical timer wheel: scheduling and cancelling are O(1), and every tick only
+    // touches the timers that expire (or cascade down a level) on that tick
+    class TimerWheel {
+    public:
+        typedef void (*TimerCallback)(TimerNode& timer, void* arg);
+
+        TimerWheel(const unsigned long nowMillis);
+
+        TimerWheel(const TimerWheel& other) = delete;
+        TimerWheel& operator=(const TimerWheel& other) = delete;
+
+        void schedule(TimerNode& timer, const unsigned long delayMillis);
+
+        // runs all the ticks up to `nowMillis`, calling `callback` for every expired timer.
+        // The callback may reschedule or cancel any timer
+        void advance(const unsigned long nowMillis, TimerCallback callback, void* arg);
+
+        ~TimerWheel();
+
+    private:
+        TimerNode* _slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+        unsigned long _currentTick;
+        unsigned long _lastTickMillis;
+
+        void insert(TimerNode& timer);
+        void tick(TimerCallback callback, void* arg);
+    };
+}} // websockets::internals
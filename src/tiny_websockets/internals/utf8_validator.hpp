@@ -0,0 +1,35 @@
+#pragma once
+
+#include <tiny_websockets/internals/ws_common.hpp>
+
+namespace websockets { namespace internals {
+    // Incremental UTF-8 validation (RFC 3629: no overlong forms, no surrogates, nothing above U+10FFFF).
+    // A text message can be fed fragment by fragment, a character may span fragments.
+    // Whole 16 byte blocks are checked with SSSE3 (x86) or NEON (aarch64) when available, the
+    // edges of every fragment go through a scalar state machine
+    class Utf8Validator {
+    public:
+        Utf8Validator() { reset(); }
+
+        // starts a new message
+        void reset() {
+            this->_remaining = 0;
+            this->_lower = 0x80;
+            this->_upper = 0xBF;
+        }
+
+        // false as soon as the data can't be valid UTF-8 (whatever comes next)
+        bool feed(const uint8_t* data, size_t len);
+
+        // true when the data fed so far doesn't end in the middle of a character
+        bool isComplete() const { return this->_remaining == 0; }
+
+    private:
+        // continuation bytes still expected, and the range allowed for the next one
+        uint8_t _remaining;
+        uint8_t _lower;
+        uint8_t _upper;
+
+        bool feedScalar(const uint8_t* data, size_t len);
+    };
+}} // websockets::internals
@@ -3,10 +3,12 @@
 #include <tiny_websockets/internals/ws_common.hpp>
 #include <tiny_websockets/network/tcp_client.hpp>
 #include <tiny_websockets/internals/data_frame.hpp>
+#include <tiny_websockets/internals/utf8_validator.hpp>
+#include <tiny_websockets/internals/memory_budget.hpp>
+#include <tiny_websockets/internals/buffer_pool.hpp>
 #include <tiny_websockets/message.hpp>
 #include <memory>
 
-#define __TINY_WS_INTERNAL_DEFAULT_MASK "\00\00\00\00"
 
 namespace websockets {     
     enum FragmentsPolicy {
@@ -31,26 +33,54 @@ namespace websockets {
     CloseReason GetCloseReason(uint16_t reasonCode);
     
     namespace internals {
-    
-    class WebsocketsEndpoint {
+
+    // XORs `data` with the masking key, `keyOffset` is the position of `data[0]` within the payload.
+    // Shared with StaticWebsocketsEndpoint, like the frame reading in websockets_endpoint_impl.hpp
+    void applyMask(uint8_t* data, const size_t len, const uint8_t* const maskingKey, const size_t keyOffset);
+
+    // Clients mask what they send and must not receive masked frames, servers the reverse (RFC 6455 5.1).
+    // Defining _WS_CONFIG_CLIENT_ONLY or _WS_CONFIG_SERVER_ONLY fixes the role at compile time, the frame
+    // code is then only built for that role (and the explicit `mask` of `send` must match it)
+    enum EndpointRole {
+        EndpointRole_Client,
+        EndpointRole_Server
+    };
+
+    // `Transport` is the connection the endpoint reads from and writes to. WebsocketsEndpoint goes through the
+    // virtual network::TcpClient interface, which lets a client switch transports at runtime. Binding a
+    // concrete `final` transport class instead lets the compiler inline its reads, sends and `available`.
+    // Only WebsocketsEndpoint is built by the library, include websockets_endpoint_impl.hpp to bind another one
+    template <class Transport = network::TcpClient>
+    class BasicWebsocketsEndpoint {
     public:
-        WebsocketsEndpoint(std::shared_ptr<network::TcpClient> socket, FragmentsPolicy fragmentsPolicy = FragmentsPolicy_Aggregate);
+        BasicWebsocketsEndpoint(std::shared_ptr<Transport> socket, FragmentsPolicy fragmentsPolicy = FragmentsPolicy_Aggregate);
 
-        WebsocketsEndpoint(const WebsocketsEndpoint& other);
-        WebsocketsEndpoint(const WebsocketsEndpoint&& other);
+        // an endpoint is the only owner of its connection state, it can be moved but not copied
+        BasicWebsocketsEndpoint(const BasicWebsocketsEndpoint& other) = delete;
+        BasicWebsocketsEndpoint(BasicWebsocketsEndpoint&& other) noexcept;
         
-        WebsocketsEndpoint& operator=(const WebsocketsEndpoint& other);
-        WebsocketsEndpoint& operator=(const WebsocketsEndpoint&& other);
+        BasicWebsocketsEndpoint& operator=(const BasicWebsocketsEndpoint& other) = delete;
+        BasicWebsocketsEndpoint& operator=(BasicWebsocketsEndpoint&& other) noexcept;
 
-        void setInternalSocket(std::shared_ptr<network::TcpClient> socket);
+        void setInternalSocket(std::shared_ptr<Transport> socket);
+        // forgets everything about the previous connection (half received fragments, close reason)
+        void resetConnectionState();
 
         bool poll();
         WebsocketsMessage recv();
-        bool send(const char* data, const size_t len, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey = __TINY_WS_INTERNAL_DEFAULT_MASK);    
-        bool send(const WSString& data, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey = __TINY_WS_INTERNAL_DEFAULT_MASK);
+        // masked frames get a fresh random masking key, unless `maskingKey` (4 bytes) is given.
+        // Builds with a fixed role (see EndpointRole) refuse the masking of the other role
+        bool send(const char* data, const size_t len, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey = nullptr);    
+        bool send(const WSString& data, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey = nullptr);
         
         bool send(const char* data, const size_t len, const uint8_t opcode, const bool fin);    
         bool send(const WSString& data, const uint8_t opcode, const bool fin);
+
+#ifdef __linux__
+        // sends `len` bytes of the file `fd` (from `offset`) as a single frame. Unmasked frames go through
+        // the transport's `sendFile` (zero copy) when it supports it, otherwise the file is read in chunks
+        bool sendFile(int fd, const uint64_t offset, const uint64_t len, const uint8_t opcode, const bool fin);
+#endif
         
         bool ping(const WSString& msg);
         bool ping(const WSString&& msg);
@@ -64,13 +94,59 @@ namespace websockets {
         void setFragmentsPolicy(const FragmentsPolicy newPolicy);
         FragmentsPolicy getFragmentsPolicy() const;
 
+        // only changes whether sent frames are masked, what is accepted from the peer follows the role
         void setUseMasking(bool useMasking) {
             _useMasking = useMasking;
         }
 
-        virtual ~WebsocketsEndpoint();
+        void setRole(EndpointRole role) {
+            _role = role;
+        }
+
+        EndpointRole role() const {
+#if defined(_WS_CONFIG_CLIENT_ONLY)
+            return EndpointRole_Client;
+#elif defined(_WS_CONFIG_SERVER_ONLY)
+            return EndpointRole_Server;
+#else
+            return this->_role;
+#endif
+        }
+
+        // Text messages (and each fragment of them) are checked as they arrive, invalid UTF-8
+        // closes the connection with CloseReason_InvalidPayloadData
+        void setUtf8Validation(const bool validate) {
+            _validateUtf8 = validate;
+            _utf8Validator.reset();
+        }
+
+        // Limits on received data (0 means unlimited), checked before anything is allocated for a frame.
+        // `maxBufferedBytes` bounds what is held at once: the aggregated fragments plus the frame being read.
+        // Frames over a limit close the connection with CloseReason_MessageTooBig (1009).
+        // Frame and message sizes default to _WS_CONFIG_MAX_MESSAGE_SIZE when it is defined
+        void setSizeLimits(const size_t maxFrameSize, const size_t maxMessageSize, const size_t maxBufferedBytes);
+
+#ifdef __linux__
+        // Aggregated messages over `threshold` bytes (0 disables) are moved to an unlinked temporary file
+        // in `directory` (which must stay valid) and delivered as a read-only mapping of it
+        void setMessageSpill(const size_t threshold, const char* directory);
+#endif
+
+        // Received payloads are charged to `account`, nothing is read while it is paused and the
+        // connection is closed with CloseReason_MessageTooBig when the budget asks for it
+        void setMemoryAccount(std::shared_ptr<MemoryAccount> account);
+        // charges the account with what is still held (fragments being aggregated), the messages
+        // returned by `recv` are not counted anymore
+        void settleMemory();
+
+        // frees the buffers kept for reuse, for connections that went idle
+        void releaseBuffers() {
+            _buffers.clear();
+        }
+
+        virtual ~BasicWebsocketsEndpoint();
     private:
-        std::shared_ptr<network::TcpClient> _client;
+        std::shared_ptr<Transport> _client;
         FragmentsPolicy _fragmentsPolicy;
         enum RecvMode {
             RecvMode_Normal,
@@ -78,9 +154,26 @@ namespace websockets {
         } _recvMode;
         WebsocketsMessage::StreamBuilder _streamBuilder;
         CloseReason _closeReason;
+        EndpointRole _role = EndpointRole_Client;
         bool _useMasking = true;
+        bool _validateUtf8 = false;
+        Utf8Validator _utf8Validator;
+        size_t _maxFrameSize;
+        size_t _maxMessageSize;
+        size_t _maxBufferedBytes;
+        std::shared_ptr<MemoryAccount> _memory;
+        size_t _spillThreshold;
+        const char* _spillDirectory;
+        // recycles the buffers of consumed fragments and of sent frames
+        BufferPool _buffers;
 
         WebsocketsFrame _recv();
+        // `Masked` is a bool, or a std::integral_constant when the role is fixed at compile time
+        template <class Masked> WebsocketsFrame recvFrame(const Masked masked);
+        template <class Masked> bool sendFrame(const Masked masked, const char* data, const size_t len, const uint8_t opcode, const bool fin, const char* maskingKey);
+        CloseReason checkFrameSize(const uint8_t opcode, const uint64_t payloadLength);
+        void resetStreamBuilder();
+        bool validateUtf8(const WebsocketsFrame& frame);
         void handleMessageInternally(WebsocketsMessage& msg);
 
         WebsocketsMessage handleFrameInStreamingMode(WebsocketsFrame& frame);
@@ -88,4 +181,7 @@ namespace websockets {
 
         std::string getHeader(uint64_t len, uint8_t opcode, bool fin, bool mask);
     };
+
+    typedef BasicWebsocketsEndpoint<> WebsocketsEndpoint;
+    extern template class BasicWebsocketsEndpoint<network::TcpClient>;
 }} // websockets::internals
\ No newline at end of file
@@ -0,0 +1,657 @@
+#pragma once
+
+#include <tiny_websockets/internals/websockets_endpoint.hpp>
+#include <tiny_websockets/internals/wscrypto/crypto.hpp>
+#include <type_traits>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// The definitions of BasicWebsocketsEndpoint. WebsocketsEndpoint is built once in websockets_endpoint.cpp,
+// include this header where an endpoint is bound to another transport
+
+namespace websockets { namespace internals {
+    uint32_t swapEndianess(uint32_t num);
+    uint64_t swapEndianess(uint64_t num);
+
+    // Frame level reading, shared with StaticWebsocketsEndpoint
+    template <class Socket>
+    uint32_t readUntilSuccessfullOrError(Socket& socket, uint8_t* buffer, const uint32_t len) {
+        auto numRead = socket.read(buffer, len);
+        while(numRead == static_cast<uint32_t>(-1) && socket.available()) {
+            numRead = socket.read(buffer, len);
+        }
+        return numRead;
+    }
+
+    template <class Socket>
+    Header readHeaderFromSocket(Socket& socket) {
+        Header header;
+        header.payload = 0;
+        readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&header), 2);
+        return header;
+    }
+
+    template <class Socket>
+    uint64_t readExtendedPayloadLength(Socket& socket, const Header& header) {
+        uint64_t extendedPayload = header.payload;
+        // in case of extended payload length
+        if (header.payload == 126) {
+            // read next 16 bits as payload length
+            uint16_t tmp = 0;
+            readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&tmp), 2);
+            tmp = (tmp << 8) | (tmp >> 8);
+            extendedPayload = tmp;
+        }
+        else if (header.payload == 127) {
+            uint64_t tmp = 0;
+            readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&tmp), 8);
+            extendedPayload = swapEndianess(tmp);
+        }
+
+        return extendedPayload;
+    }
+
+    template <class Socket>
+    void readMaskingKey(Socket& socket, uint8_t* outputBuffer) {
+        readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(outputBuffer), 4);
+    }
+
+    // The payload is read straight into a (possibly recycled) buffer from `pool`
+    template <class Socket>
+    WSString readData(Socket& socket, uint64_t extendedPayload, BufferPool& pool) {
+        const uint64_t BUFFER_SIZE = _WS_BUFFER_SIZE;
+
+        WSString data = pool.take(extendedPayload);
+        data.resize(extendedPayload);
+        uint64_t done_reading = 0;
+        while (done_reading < extendedPayload && socket.available()) {
+            uint64_t to_read = extendedPayload - done_reading >= BUFFER_SIZE ? BUFFER_SIZE : extendedPayload - done_reading;
+            uint32_t numReceived = readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&data[done_reading]), to_read);
+
+            // On failed reads, skip
+            if(!socket.available()) break;
+
+            done_reading += numReceived;
+        }
+        return data;
+    }
+
+    // Whether the frames an endpoint sends and receives are masked. Constants when the role is fixed
+    // at compile time, so the frame code is only built for that role. Otherwise sending follows
+    // `setUseMasking` and receiving follows the role
+#if defined(_WS_CONFIG_CLIENT_ONLY)
+    inline std::true_type sendsMasked(const EndpointRole, const bool) { return std::true_type(); }
+    inline std::false_type receivesMasked(const EndpointRole) { return std::false_type(); }
+#elif defined(_WS_CONFIG_SERVER_ONLY)
+    inline std::false_type sendsMasked(const EndpointRole, const bool) { return std::false_type(); }
+    inline std::true_type receivesMasked(const EndpointRole) { return std::true_type(); }
+#else
+    inline bool sendsMasked(const EndpointRole, const bool useMasking) { return useMasking; }
+    inline bool receivesMasked(const EndpointRole role) { return role == EndpointRole_Server; }
+#endif
+
+    template <class Transport>
+    BasicWebsocketsEndpoint<Transport>::BasicWebsocketsEndpoint(std::shared_ptr<Transport> client, FragmentsPolicy fragmentsPolicy) : 
+        _client(client),
+        _fragmentsPolicy(fragmentsPolicy),
+        _recvMode(RecvMode_Normal),
+        _streamBuilder(fragmentsPolicy == FragmentsPolicy_Notify? true: false),
+        _closeReason(CloseReason_None),
+#ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
+        _maxFrameSize(_WS_CONFIG_MAX_MESSAGE_SIZE),
+        _maxMessageSize(_WS_CONFIG_MAX_MESSAGE_SIZE),
+#else
+        _maxFrameSize(0),
+        _maxMessageSize(0),
+#endif
+        _maxBufferedBytes(0),
+        _spillThreshold(0),
+        _spillDirectory(nullptr) {
+        this->_streamBuilder.setMaxSize(this->_maxMessageSize);
+    }
+
+    template <class Transport>
+    BasicWebsocketsEndpoint<Transport>::BasicWebsocketsEndpoint(BasicWebsocketsEndpoint&& other) noexcept :
+        _client(std::move(other._client)),
+        _fragmentsPolicy(other._fragmentsPolicy),
+        _recvMode(other._recvMode),
+        _streamBuilder(std::move(other._streamBuilder)),
+        _closeReason(other._closeReason),
+        _role(other._role),
+        _useMasking(other._useMasking),
+        _validateUtf8(other._validateUtf8),
+        _utf8Validator(other._utf8Validator),
+        _maxFrameSize(other._maxFrameSize),
+        _maxMessageSize(other._maxMessageSize),
+        _maxBufferedBytes(other._maxBufferedBytes),
+        _memory(std::move(other._memory)),
+        _spillThreshold(other._spillThreshold),
+        _spillDirectory(other._spillDirectory),
+        _buffers(std::move(other._buffers)) {
+        // Empty
+    }
+
+    template <class Transport>
+    BasicWebsocketsEndpoint<Transport>& BasicWebsocketsEndpoint<Transport>::operator=(BasicWebsocketsEndpoint&& other) noexcept {
+        if(&other == this) return *this;
+
+        this->_client = std::move(other._client);
+        this->_fragmentsPolicy = other._fragmentsPolicy;
+        this->_recvMode = other._recvMode;
+        this->_streamBuilder = std::move(other._streamBuilder);
+        this->_closeReason = other._closeReason;
+        this->_role = other._role;
+        this->_useMasking = other._useMasking;
+        this->_validateUtf8 = other._validateUtf8;
+        this->_utf8Validator = other._utf8Validator;
+        this->_maxFrameSize = other._maxFrameSize;
+        this->_maxMessageSize = other._maxMessageSize;
+        this->_maxBufferedBytes = other._maxBufferedBytes;
+        this->_memory = std::move(other._memory);
+        this->_spillThreshold = other._spillThreshold;
+        this->_spillDirectory = other._spillDirectory;
+        this->_buffers = std::move(other._buffers);
+
+        return *this;
+    }
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::setInternalSocket(std::shared_ptr<Transport> socket) {
+        this->_client = socket;
+        resetConnectionState();
+    }
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::resetConnectionState() {
+        this->_recvMode = RecvMode_Normal;
+        resetStreamBuilder();
+        this->_closeReason = CloseReason_None;
+        this->_utf8Validator.reset();
+        if(this->_memory) this->_memory->release();
+    }
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::resetStreamBuilder() {
+        this->_streamBuilder = WebsocketsMessage::StreamBuilder(this->_fragmentsPolicy == FragmentsPolicy_Notify, this->_maxMessageSize);
+#ifdef __linux__
+        this->_streamBuilder.setSpill(this->_spillThreshold, this->_spillDirectory);
+#endif
+    }
+
+#ifdef __linux__
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::setMessageSpill(const size_t threshold, const char* directory) {
+        this->_spillThreshold = threshold;
+        this->_spillDirectory = directory;
+        this->_streamBuilder.setSpill(threshold, directory);
+    }
+#endif
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::setSizeLimits(const size_t maxFrameSize, const size_t maxMessageSize, const size_t maxBufferedBytes) {
+        this->_maxFrameSize = maxFrameSize;
+        this->_maxMessageSize = maxMessageSize;
+        this->_maxBufferedBytes = maxBufferedBytes;
+        this->_streamBuilder.setMaxSize(maxMessageSize);
+    }
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::setMemoryAccount(std::shared_ptr<MemoryAccount> account) {
+        if(this->_memory) this->_memory->release();
+        this->_memory = account;
+        settleMemory();
+    }
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::settleMemory() {
+        if(!this->_memory) return;
+
+        // in notify mode fragments are handed out as they arrive, and spilled messages are not in memory
+        this->_memory->settle(this->_streamBuilder.bufferedSize());
+    }
+
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::poll() {
+        if(this->_memory) {
+            if(this->_memory->isCloseRequested()) {
+                close(CloseReason_MessageTooBig);
+                return false;
+            }
+            if(this->_memory->isPaused()) return false;
+        }
+        return this->_client->poll();
+    }
+
+
+    template <class Transport>
+    WebsocketsFrame BasicWebsocketsEndpoint<Transport>::_recv() {
+        return recvFrame(receivesMasked(role()));
+    }
+
+    // Servers only get masked frames and clients only unmasked ones, anything else is a protocol error
+    template <class Transport> template <class Masked>
+    WebsocketsFrame BasicWebsocketsEndpoint<Transport>::recvFrame(const Masked masked) {
+        auto header = readHeaderFromSocket(*this->_client);
+        if(!_client->available()) return WebsocketsFrame(); // In case of faliure
+
+        if(header.mask != masked) {
+            close(CloseReason_ProtocolError);
+            return WebsocketsFrame();
+        }
+
+        uint64_t payloadLength = readExtendedPayloadLength(*this->_client, header);
+        if(!_client->available()) return WebsocketsFrame(); // In case of faliure
+
+        CloseReason sizeError = checkFrameSize(header.opcode, payloadLength);
+        if(sizeError != CloseReason_None) {
+            close(sizeError);
+            return WebsocketsFrame();
+        }
+        if(this->_memory) {
+            this->_memory->charge(payloadLength > SIZE_MAX ? SIZE_MAX : static_cast<size_t>(payloadLength));
+        }
+
+        WebsocketsFrame frame;
+        if(masked) {
+            readMaskingKey(*this->_client, frame.mask_buf);
+            if(!_client->available()) return WebsocketsFrame(); // In case of faliure
+        }
+
+        // read the message's payload (data) according to the read length
+        frame.payload = readData(*this->_client, payloadLength, this->_buffers);
+        if(!_client->available()) return WebsocketsFrame(); // In case of faliure
+
+        if(masked) {
+            applyMask(reinterpret_cast<uint8_t*>(&frame.payload[0]), payloadLength, frame.mask_buf, 0);
+        }
+
+        // Construct frame from data and header that was read
+        frame.fin = header.fin;
+        frame.mask = masked;
+        frame.opcode = header.opcode;
+        frame.payload_length = payloadLength;
+
+        return frame;
+    }
+
+    // Decides if a frame may be read at all, only its header was read so nothing is allocated yet
+    template <class Transport>
+    CloseReason BasicWebsocketsEndpoint<Transport>::checkFrameSize(const uint8_t opcode, const uint64_t payloadLength) {
+        if(opcode & 0x8) {
+            // control frames can't be longer than 125 bytes (RFC 6455 5.5)
+            return payloadLength > 125 ? CloseReason_ProtocolError : CloseReason_None;
+        }
+
+        // a continuation adds to the message being built, anything else starts a new one
+        const bool continuation = opcode == ContentType::Continuation && this->_recvMode == RecvMode_Streaming;
+
+        // whatever the limits are, the payload (and what it's appended to) has to fit in a string
+        const uint64_t maxStringSize = WSString().max_size();
+        const uint64_t buffered = continuation ? this->_streamBuilder.bufferedSize() : 0;
+        if(payloadLength > maxStringSize || buffered > maxStringSize - payloadLength) {
+            return CloseReason_MessageTooBig;
+        }
+
+        if(this->_maxFrameSize != 0 && payloadLength > this->_maxFrameSize) {
+            return CloseReason_MessageTooBig;
+        }
+
+        const bool tooBig = continuation ?
+            !this->_streamBuilder.fits(payloadLength) :
+            (this->_maxMessageSize != 0 && payloadLength > this->_maxMessageSize);
+        if(tooBig) return CloseReason_MessageTooBig;
+
+        if(this->_maxBufferedBytes != 0) {
+            if(payloadLength > this->_maxBufferedBytes || buffered > this->_maxBufferedBytes - payloadLength) {
+                return CloseReason_MessageTooBig;
+            }
+        }
+        return CloseReason_None;
+    }
+
+    template <class Transport>
+    WebsocketsMessage BasicWebsocketsEndpoint<Transport>::handleFrameInStreamingMode(WebsocketsFrame& frame) {
+        if(frame.isControlFrame()) {
+            auto msg = WebsocketsMessage::CreateFromFrame(std::move(frame));
+            this->handleMessageInternally(msg);
+            return msg;
+        }
+        else if(frame.isBeginningOfFragmentsStream()) {
+            this->_recvMode = RecvMode_Streaming;
+
+            if(this->_streamBuilder.isEmpty()) {
+                this->_streamBuilder.first(frame);
+                if(this->_streamBuilder.isOk()) {
+                    // if policy is set to notify, return the frame to the user
+                    if(this->_fragmentsPolicy == FragmentsPolicy_Notify) {
+                        return WebsocketsMessage(this->_streamBuilder.type(), std::move(frame.payload), MessageRole::First);
+                    }
+                    else return {};
+                }
+            }
+        }
+        else if(frame.isContinuesFragment()) {
+            this->_streamBuilder.append(frame);
+            if(this->_streamBuilder.isOk()) {
+                // if policy is set to notify, return the frame to the user
+                if(this->_fragmentsPolicy == FragmentsPolicy_Notify) {
+                    return WebsocketsMessage(this->_streamBuilder.type(), std::move(frame.payload), MessageRole::Continuation);
+                }
+                // the payload was copied into the message
+                this->_buffers.give(std::move(frame.payload));
+                return {};
+            }
+        }
+        else if(frame.isEndOfFragmentsStream()) {
+            this->_recvMode = RecvMode_Normal;
+            this->_streamBuilder.end(frame);
+            if(this->_streamBuilder.isOk()) {
+                // if policy is set to notify, return the frame to the user
+                if(this->_fragmentsPolicy == FragmentsPolicy_Aggregate) {
+                    this->_buffers.give(std::move(frame.payload));
+                    auto completeMessage = this->_streamBuilder.build();
+                    resetStreamBuilder();
+                    this->handleMessageInternally(completeMessage);
+                    return completeMessage;
+                }
+                else { // in case of notify policy
+                    auto messageType = this->_streamBuilder.type();
+                    resetStreamBuilder();
+                    return WebsocketsMessage(messageType, std::move(frame.payload), MessageRole::Last);
+                }                
+            }
+        } 
+        
+        // Error
+#ifdef __linux__
+        if(this->_streamBuilder.isSpillFailed()) {
+            close(CloseReason_InternalServerError);
+            return {};
+        }
+#endif
+        close(CloseReason_ProtocolError);
+        return {};
+    }
+
+    template <class Transport>
+    WebsocketsMessage BasicWebsocketsEndpoint<Transport>::handleFrameInStandardMode(WebsocketsFrame& frame) {
+        // Normal (unfragmented) frames are handled as a complete message 
+        if(frame.isNormalUnfragmentedMessage() || frame.isControlFrame()) {
+            auto msg = WebsocketsMessage::CreateFromFrame(std::move(frame));
+            this->handleMessageInternally(msg);
+            return msg;
+        } 
+        else if(frame.isBeginningOfFragmentsStream()) {
+            return handleFrameInStreamingMode(frame);
+        }
+
+        // This is an error. a bad combination of opcodes and fin flag arrived.
+        close(CloseReason_ProtocolError);
+        return {};
+    }
+
+    // Text payloads are validated as they arrive, a character may continue in the next fragment
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::validateUtf8(const WebsocketsFrame& frame) {
+        if(frame.opcode == ContentType::Text) {
+            this->_utf8Validator.reset();
+        } else if(frame.opcode != ContentType::Continuation ||
+                  this->_recvMode != RecvMode_Streaming ||
+                  this->_streamBuilder.isEmpty() ||
+                  this->_streamBuilder.type() != MessageType::Text) {
+            return true;
+        }
+
+        if(!this->_utf8Validator.feed(reinterpret_cast<const uint8_t*>(frame.payload.data()), frame.payload.size())) {
+            return false;
+        }
+        return !frame.fin || this->_utf8Validator.isComplete();
+    }
+
+    template <class Transport>
+    WebsocketsMessage BasicWebsocketsEndpoint<Transport>::recv() {        
+        settleMemory();
+        auto frame = _recv();
+        if (frame.isEmpty()) {
+            return {};
+        }
+
+        if(this->_validateUtf8 && !validateUtf8(frame)) {
+            close(CloseReason_InvalidPayloadData);
+            return {};
+        }
+
+        if(this->_recvMode == RecvMode_Normal) {
+            return handleFrameInStandardMode(frame);
+        } 
+        else /* this->_recvMode == RecvMode_Streaming */ {
+            return handleFrameInStreamingMode(frame);
+        }
+    }
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::handleMessageInternally(WebsocketsMessage& msg) {
+        if(msg.isPing()) {
+            pong(internals::fromInterfaceString(msg.data()));
+        } else if(msg.isClose()) {
+            // is there a reason field
+            if(internals::fromInterfaceString(msg.data()).size() >= 2) {
+                uint16_t reason = *(reinterpret_cast<const uint16_t*>(msg.data().c_str()));
+                reason = reason >> 8 | reason << 8;
+                this->_closeReason = GetCloseReason(reason);
+            } else {
+                this->_closeReason = CloseReason_GoingAway;
+            }
+            close(this->_closeReason);
+        }
+    }
+
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::send(const char* data, const size_t len, const uint8_t opcode, const bool fin) {
+        return sendFrame(sendsMasked(role(), this->_useMasking), data, len, opcode, fin, nullptr);
+    }
+
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::send(const WSString& data, const uint8_t opcode, const bool fin) {
+        return this->send(data.c_str(), data.size(), opcode, fin);
+    }
+
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::send(const WSString& data, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey) { 
+        return send(data.c_str(), data.size(), opcode, fin, mask, maskingKey);
+    }
+
+    template <class Transport>
+    std::string BasicWebsocketsEndpoint<Transport>::getHeader(uint64_t len, uint8_t opcode, bool fin, bool mask) {
+      std::string header_data;
+      
+        if(len < 126) {
+            auto header = MakeHeader<Header>(len, opcode, fin, mask);
+            header_data = std::string(reinterpret_cast<char*>(&header), 2 + 0);
+        } else if(len < 65536) {
+            auto header = MakeHeader<HeaderWithExtended16>(len, opcode, fin, mask);
+            header.extendedPayload = (len << 8) | (len >> 8);
+            header_data = std::string(reinterpret_cast<char*>(&header), 2 + 2);
+        } else {
+            auto header = MakeHeader<HeaderWithExtended64>(len, opcode, fin, mask);
+            // header.extendedPayload = swapEndianess(len);
+            header.extendedPayload = swapEndianess(len);
+
+            header_data = std::string(reinterpret_cast<char*>(&header), 2);
+            header_data += std::string(reinterpret_cast<char*>(&header.extendedPayload), 8);
+        }
+
+        return header_data;
+    }
+
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::send(const char* data, const size_t len, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey) {
+#if defined(_WS_CONFIG_CLIENT_ONLY) || defined(_WS_CONFIG_SERVER_ONLY)
+        if(mask != sendsMasked(role(), this->_useMasking)) return false;
+        return sendFrame(sendsMasked(role(), this->_useMasking), data, len, opcode, fin, maskingKey);
+#else
+        return sendFrame(mask, data, len, opcode, fin, maskingKey);
+#endif
+    }
+
+    template <class Transport> template <class Masked>
+    bool BasicWebsocketsEndpoint<Transport>::sendFrame(const Masked masked, const char* data, const size_t len, const uint8_t opcode, const bool fin, const char* maskingKey) {
+#ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
+        if(len > _WS_CONFIG_MAX_MESSAGE_SIZE) {
+            return false;
+        }
+#endif
+        uint8_t randomKey[4];
+        if (masked && maskingKey == nullptr) {
+          crypto::randomFill(randomKey, 4);
+          maskingKey = reinterpret_cast<const char*>(randomKey);
+        }
+
+        // send the header, the frame is assembled in a recycled buffer
+        WSString message_data = this->_buffers.take(14 + len);
+        message_data += getHeader(len, opcode, fin, masked);
+
+        if (masked) {
+          message_data.append(maskingKey, 4);
+        }
+
+        size_t data_start = message_data.size();
+        message_data.append(data, len);
+
+        if (masked) {
+          applyMask(reinterpret_cast<uint8_t*>(&message_data[data_start]), len, reinterpret_cast<const uint8_t*>(maskingKey), 0);
+        }
+
+        this->_client->send(reinterpret_cast<const uint8_t*>(message_data.c_str()), message_data.size());
+        this->_buffers.give(std::move(message_data));
+        return true; // TODO dont assume success
+    }
+
+#ifdef __linux__
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::sendFile(int fd, const uint64_t offset, const uint64_t len, const uint8_t opcode, const bool fin) {
+#ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
+        if(len > _WS_CONFIG_MAX_MESSAGE_SIZE) {
+            return false;
+        }
+#endif
+        const auto masked = sendsMasked(role(), this->_useMasking);
+        uint8_t maskingKey[4];
+        std::string header = getHeader(len, opcode, fin, masked);
+        if(masked) {
+            crypto::randomFill(maskingKey, 4);
+            header.append(reinterpret_cast<const char*>(maskingKey), 4);
+        }
+        this->_client->send(reinterpret_cast<const uint8_t*>(header.c_str()), header.size());
+
+        if(!masked) {
+            if(this->_client->sendFile(fd, offset, len)) return true;
+            if(!this->_client->available()) return false;
+        }
+
+        // no zero copy path, the payload is read (and masked) in chunks
+        uint8_t buffer[4 * _WS_BUFFER_SIZE];
+        uint64_t done = 0;
+        while(done < len && this->_client->available()) {
+            const size_t chunk = len - done < sizeof(buffer) ? len - done : sizeof(buffer);
+            const ssize_t numRead = pread(fd, buffer, chunk, offset + done);
+            if(numRead <= 0) {
+                // the frame header promised more, the connection can't be used anymore
+                this->_client->close();
+                return false;
+            }
+            if(masked) {
+                applyMask(buffer, numRead, maskingKey, done);
+            }
+            this->_client->send(buffer, numRead);
+            done += numRead;
+        }
+        return done == len;
+    }
+#endif
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::close(CloseReason reason) {
+        this->_closeReason = reason;
+        if(this->_memory) {
+            // whatever was being aggregated can't complete anymore
+            resetStreamBuilder();
+            this->_memory->release();
+        }
+        
+        if(!this->_client->available()) return;
+
+        if(reason == CloseReason_None) {
+            send(nullptr, 0, internals::ContentType::Close, true);
+        } else {
+            uint16_t reasonNum = static_cast<uint16_t>(reason);
+            reasonNum = (reasonNum >> 8) | (reasonNum << 8);
+            send(reinterpret_cast<const char*>(&reasonNum), 2, internals::ContentType::Close, true);
+        }
+        this->_client->close();
+    }
+
+    template <class Transport>
+    CloseReason BasicWebsocketsEndpoint<Transport>::getCloseReason() const {
+        return _closeReason;
+    }
+
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::ping(const WSString& msg) {
+        // Ping data must be shorter than 125 bytes
+        if(msg.size() > 125) {
+            return false;
+        }
+        else {
+            return send(msg, ContentType::Ping, true);
+        }
+    }
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::ping(const WSString&& msg) {
+        // Ping data must be shorter than 125 bytes
+        if(msg.size() > 125) {
+            return false;
+        }
+        else {
+            return send(msg, ContentType::Ping, true);
+        }
+    }
+
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::pong(const WSString& msg) {
+        // Pong data must be shorter than 125 bytes
+        if(msg.size() > 125)  {
+            return false;
+        }
+        else {
+            return this->send(msg, ContentType::Pong, true);
+        }
+    }
+    template <class Transport>
+    bool BasicWebsocketsEndpoint<Transport>::pong(const WSString&& msg) {
+        // Pong data must be shorter than 125 bytes
+        if(msg.size() > 125)  {
+            return false;
+        }
+        else {
+            return this->send(msg, ContentType::Pong, true);
+        }
+    }
+
+    template <class Transport>
+    void BasicWebsocketsEndpoint<Transport>::setFragmentsPolicy(FragmentsPolicy newPolicy) {
+        this->_fragmentsPolicy = newPolicy;
+        // the builder only keeps fragments under the aggregate policy
+        if(this->_streamBuilder.isEmpty()) resetStreamBuilder();
+    }
+
+    template <class Transport>
+    FragmentsPolicy BasicWebsocketsEndpoint<Transport>::getFragmentsPolicy() const {
+        return this->_fragmentsPolicy;
+    }
+
+    template <class Transport>
+    BasicWebsocketsEndpoint<Transport>::~BasicWebsocketsEndpoint() {}
+}} // websockets::internals
@@ -2,11 +2,26 @@
 
 #include <tiny_websockets/ws_config_defs.hpp>
 #include <string>
-#include <Arduino.h>
+
+#ifdef ARDUINO
+    #include <Arduino.h>
+#else
+    #include <stdint.h>
+    #include <string.h>
+#endif
 
 namespace websockets {
     typedef std::string WSString;
+#ifdef ARDUINO
     typedef String WSInterfaceString;
+#else
+    typedef std::string WSInterfaceString;
+#endif
+
+#ifndef ARDUINO
+    // Milliseconds since an arbitrary point (like Arduino's millis), for host builds
+    unsigned long millis();
+#endif
 
     namespace internals {
         WSString fromInterfaceString(const WSInterfaceString& str);
@@ -50,4 +65,19 @@ namespace websockets {
 
     #define WSDefaultTcpClient websockets::network::Teensy41TcpClient
     #define WSDefaultTcpServer websockets::network::Teensy41TcpServer    
+
+#elif defined(__linux__)
+    #include <tiny_websockets/network/linux/linux_tcp_client.hpp>
+    #include <tiny_websockets/network/linux/linux_tcp_server.hpp>
+    #include <tiny_websockets/network/linux/linux_unix_socket_client.hpp>
+    #include <tiny_websockets/network/linux/linux_unix_socket_server.hpp>
+
+    #define WSDefaultTcpClient websockets::network::LinuxTcpClient
+    #define WSDefaultTcpServer websockets::network::LinuxTcpServer
+
+    #ifndef _WS_CONFIG_NO_SSL
+        // OpenSSL Dependent (link with -lssl -lcrypto)
+        #include <tiny_websockets/network/linux/linux_secured_tcp_client.hpp>
+        #define WSDefaultSecuredTcpClient websockets::network::SecuredLinuxTcpClient
+    #endif //_WS_CONFIG_NO_SSL
 #endif
@@ -3,7 +3,7 @@
 #include <tiny_websockets/internals/ws_common.hpp>
 
 namespace websockets { namespace crypto { namespace internals {
-/* 
+/*
    base64.cpp and base64.hpp
 
    Copyright (C) 2004-2008 René Nyffenegger
@@ -30,97 +30,30 @@ namespace websockets { namespace crypto { namespace internals {
 
 */
 
-static const WSString base64_chars = 
-             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-             "abcdefghijklmnopqrstuvwxyz"
-             "0123456789+/";
-
+/*
+   ALTERED: rewritten to be table driven and to write into preallocated buffers,
+   with SSSE3 (x86) and NEON (aarch64) paths for longer inputs. See base64.cpp
+*/
 
-static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
+// size of the (padded) encoding of `len` bytes
+inline size_t base64_encoded_size(const size_t len) {
+  return (len + 2) / 3 * 4;
 }
 
-WSString base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
-  WSString ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  while (in_len--) {
-    char_array_3[i++] = *(bytes_to_encode++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-
-      for(i = 0; (i <4) ; i++)
-        ret += base64_chars[char_array_4[i]];
-      i = 0;
-    }
-  }
-
-  if (i)
-  {
-    for(j = i; j < 3; j++)
-      char_array_3[j] = '\0';
-
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
-
-    for (j = 0; (j < i + 1); j++)
-      ret += base64_chars[char_array_4[j]];
-
-    while((i++ < 3))
-      ret += '=';
+// upper bound for the decoded size of `len` base64 characters
+inline size_t base64_decoded_max_size(const size_t len) {
+  return (len + 3) / 4 * 3;
+}
 
-  }
+// Encodes into `out`, which must have room for base64_encoded_size(len) chars (no null terminator
+// is written). Returns the number of chars written
+size_t base64_encode(const uint8_t* bytes, size_t len, char* out);
 
-  return ret;
+// Decodes into `out`, which must have room for base64_decoded_max_size(len) bytes. Decoding stops
+// at the first padding or non base64 character. Returns the number of bytes written
+size_t base64_decode(const char* encoded, size_t len, uint8_t* out);
 
-}
-WSString base64_decode(WSString const& encoded_string) {
-  int in_len = encoded_string.size();
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
-  WSString ret;
-
-  while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_]; in_++;
-    if (i ==4) {
-      for (i = 0; i <4; i++)
-        char_array_4[i] = base64_chars.find(char_array_4[i]);
-
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-      for (i = 0; (i < 3); i++)
-        ret += char_array_3[i];
-      i = 0;
-    }
-  }
-
-  if (i) {
-    for (j = i; j <4; j++)
-      char_array_4[j] = 0;
-
-    for (j = 0; j <4; j++)
-      char_array_4[j] = base64_chars.find(char_array_4[j]);
-
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-    for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
-  }
-
-  return ret;
-}
+WSString base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len);
+WSString base64_decode(WSString const& encoded_string);
 
-}}} // websockets::crypto::internals
\ No newline at end of file
+}}} // websockets::crypto::internals
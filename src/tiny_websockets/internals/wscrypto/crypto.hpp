@@ -1,11 +1,28 @@
 #pragma once
 
 #include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/internals/wscrypto/sha1.hpp>
 
 namespace websockets { namespace crypto {
   WSString base64Encode(WSString data);
   WSString base64Encode(uint8_t* data, size_t len);
   WSString base64Decode(WSString data);
+  // Non allocating variants, `out` needs room for ((len + 2) / 3) * 4 chars when encoding and
+  // ((len + 3) / 4) * 3 bytes when decoding. They return how much was written (no null terminator)
+  size_t base64Encode(const uint8_t* data, size_t len, char* out);
+  size_t base64Decode(const char* data, size_t len, uint8_t* out);
   WSString websocketsHandshakeEncodeKey(WSString key);
+  WSString websocketsHandshakeEncodeKey(const char* key, size_t len);
+  // Non allocating variant, `accept` gets the (null terminated) accept key
+  void websocketsHandshakeEncodeKey(const char* key, size_t len, char accept[SHA1_BASE64_SIZE]);
+
+  // Accept keys of several handshakes at once, `accepts[i]` gets the (null terminated) accept of `keys[i]`.
+  // Keys are hashed in pairs, so cpus with SHA instructions can interleave the two messages
+  void websocketsHandshakeEncodeKeys(const char* const* keys, const size_t* lens, char (*accepts)[SHA1_BASE64_SIZE], size_t count);
+
+  // Cryptographically strong random values (ChaCha20 seeded from the platform's entropy source:
+  // esp_random on ESP32/ESP8266, getrandom on Linux). Define _WS_CONFIG_NO_TRUE_RANDOMNESS for a fixed seed
+  void randomFill(uint8_t* buffer, size_t len);
   WSString randomBytes(size_t len);
+  uint32_t randomNumber();
 }} // websockets::crypto
\ No newline at end of file
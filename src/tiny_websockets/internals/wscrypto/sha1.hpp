@@ -10,6 +10,19 @@ namespace websockets { namespace crypto { namespace internals {
 #define SHA1_HEX_SIZE (40 + 1)
 #define SHA1_BASE64_SIZE (28 + 1)
 
+// Compresses `blocks` consecutive 64 byte blocks into `state`. Uses the CPU's SHA instructions
+// (SHA-NI on x86, the ARMv8 crypto extensions) when they are available at runtime, otherwise
+// sha1::process_block_portable. Implemented in sha1.cpp
+void sha1_process_blocks(uint32_t state[5], const uint8_t *data, size_t blocks);
+
+// Same as two sha1_process_blocks calls. With SHA-NI both messages are compressed interleaved,
+// which hides most of the latency of the round instructions
+void sha1_process_blocks_x2(
+    uint32_t first_state[5], const uint8_t *first_data,
+    uint32_t second_state[5], const uint8_t *second_data,
+    size_t blocks
+);
+
 class sha1 {
 private:
     void add_byte_dont_count_bits(uint8_t x){
@@ -17,7 +30,7 @@ private:
 
         if (i >= sizeof(buf)){
             i = 0;
-            process_block(buf);
+            sha1_process_blocks(state, buf, 1);
         }
     }
 
@@ -33,7 +46,8 @@ private:
             static_cast<uint32_t>(p[3] << 0*8);
     }
 
-    void process_block(const uint8_t *ptr){
+public:
+    static void process_block_portable(uint32_t state[5], const uint8_t *ptr){
         const uint32_t c0 = 0x5a827999;
         const uint32_t c1 = 0x6ed9eba1;
         const uint32_t c2 = 0x8f1bbcdc;
@@ -151,8 +165,6 @@ private:
         state[4] += e;
     }
 
-public:
-
     uint32_t state[5];
     uint8_t buf[64];
     uint32_t i;
@@ -186,10 +198,12 @@ public:
         for (; n && i % sizeof(buf); n--) add(*ptr++);
 
         // process full blocks
-        for (; n >= sizeof(buf); n -= sizeof(buf)){
-            process_block(ptr);
-            ptr += sizeof(buf);
-            n_bits += sizeof(buf) * 8;
+        const size_t blocks = n / sizeof(buf);
+        if (blocks){
+            sha1_process_blocks(state, ptr, blocks);
+            ptr += blocks * sizeof(buf);
+            n -= blocks * sizeof(buf);
+            n_bits += static_cast<uint64_t>(blocks) * sizeof(buf) * 8;
         }
 
         // process remaining part of block
@@ -199,6 +213,7 @@ public:
     }
 
     sha1& add(const char *text){
+        if (!text) return *this;
         return add(text, strlen(text));
     }
 
@@ -2,6 +2,8 @@
 
 #include <tiny_websockets/internals/ws_common.hpp>
 #include <tiny_websockets/internals/data_frame.hpp>
+#include <tiny_websockets/internals/file_buffer.hpp>
+#include <memory>
 
 namespace websockets {
     enum class MessageType {
@@ -20,7 +22,13 @@ namespace websockets {
     // This message can be partial (so practically this is a Frame and not a message)
     struct WebsocketsMessage {
         WebsocketsMessage(MessageType msgType, const WSString& msgData, MessageRole msgRole = MessageRole::Complete) : _type(msgType), _length(msgData.size()), _data(msgData), _role(msgRole) {}
+        // takes over the payload's buffer, no copy
+        WebsocketsMessage(MessageType msgType, WSString&& msgData, MessageRole msgRole = MessageRole::Complete) : _type(msgType), _length(msgData.size()), _data(std::move(msgData)), _role(msgRole) {}
         WebsocketsMessage() : WebsocketsMessage(MessageType::Empty, "", MessageRole::Complete) {}
+#ifdef __linux__
+        // a message that was spilled to a file, see StreamBuilder::setSpill
+        WebsocketsMessage(MessageType msgType, std::shared_ptr<const internals::FileBuffer> file, MessageRole msgRole = MessageRole::Complete) : _type(msgType), _length(file->size()), _data(), _role(msgRole), _file(file) {}
+#endif
 
         static WebsocketsMessage CreateFromFrame(internals::WebsocketsFrame frame, MessageType overrideType = MessageType::Empty) {
             auto type = overrideType;
@@ -68,17 +76,43 @@ namespace websockets {
         bool isLast() const { return this->_role == MessageRole::Last; }
 
 
-        WSInterfaceString data() const { return internals::fromInternalString(this->_data); }
-        const WSString& rawData() const { return this->_data; }
-        const char* c_str() const { return this->_data.c_str(); }
+        // For a message spilled to a file, `data` and `rawData` copy it into memory the first time.
+        // `c_str` (with `length`) reads the mapping directly
+        WSInterfaceString data() const { return internals::fromInternalString(rawData()); }
+        const WSString& rawData() const {
+#ifdef __linux__
+            if(this->_file && this->_fileCopy.size() != this->_length) {
+                this->_fileCopy.assign(this->_file->data(), this->_length);
+            }
+            if(this->_file) return this->_fileCopy;
+#endif
+            return this->_data;
+        }
+        const char* c_str() const {
+#ifdef __linux__
+            if(this->_file) return this->_file->data();
+#endif
+            return this->_data.c_str();
+        }
+
+        // true if the payload is a read-only mapping of a temporary file
+        bool isFileBacked() const {
+#ifdef __linux__
+            return this->_file != nullptr;
+#else
+            return false;
+#endif
+        }
 
-        uint32_t length() const { return this->_length; }
+        size_t length() const { return this->_length; }
 
         class StreamBuilder {
         public:
-            StreamBuilder(bool dummyMode = false) : _dummyMode(dummyMode), _empty(true) {}
+            // `maxSize` bounds the whole message (0 means unlimited), it is counted in dummy mode as well
+            StreamBuilder(bool dummyMode = false, uint64_t maxSize = 0) : _dummyMode(dummyMode), _empty(true), _size(0), _maxSize(maxSize) {}
 
-            void first(const internals::WebsocketsFrame& frame) {
+            // the payload of aggregated frames is taken from them
+            void first(internals::WebsocketsFrame& frame) {
                 if(this->_empty == false) {
                     badFragment();
                     return;
@@ -88,9 +122,15 @@ namespace websockets {
                 if(frame.isBeginningOfFragmentsStream()) {
                     this->_isComplete = false;
                     this->_didErrored = false;
+                    if(!fits(frame.payload.size())) {
+                        badFragment();
+                        return;
+                    }
+                    this->_size = frame.payload.size();
 
                     if(this->_dummyMode == false) {
                         this->_content = std::move(frame.payload);
+                        spillIfNeeded();
                     }
 
                     this->_type = messageTypeFromOpcode(frame.opcode);
@@ -102,33 +142,39 @@ namespace websockets {
                 }
             }
 
-            void append(const internals::WebsocketsFrame& frame) {
+            void append(internals::WebsocketsFrame& frame) {
                 if(isErrored()) return;
                 if(isEmpty() || isComplete()) {
                     badFragment();
                     return;
                 }
 
-                if(frame.isContinuesFragment()) {
+                if(frame.isContinuesFragment() && fits(frame.payload.size())) {
+                    this->_size += frame.payload.size();
                     if(this->_dummyMode == false) {
-                        this->_content += std::move(frame.payload);
+                        appendContent(frame.payload);
                     }
                 } else {
                     badFragment();
                 }
             }
 
-            void end(const internals::WebsocketsFrame& frame) {
+            void end(internals::WebsocketsFrame& frame) {
                 if(isErrored()) return;
                 if(isEmpty() || isComplete()) {
                     badFragment();
                     return;
                 }
 
-                if(frame.isEndOfFragmentsStream()) {
+                if(frame.isEndOfFragmentsStream() && fits(frame.payload.size())) {
+                    this->_size += frame.payload.size();
                     if(this->_dummyMode == false) {
-                        this->_content += std::move(frame.payload);
+                        appendContent(frame.payload);
+#ifdef __linux__
+                        if(this->_file && !this->_file->map()) spillFailed();
+#endif
                     }
+                    if(isErrored()) return;
                     this->_isComplete = true;
                 } else {
                     badFragment();
@@ -155,12 +201,51 @@ namespace websockets {
             bool isEmpty() {
                 return this->_empty;
             }
+
+            // payload bytes of the message so far
+            uint64_t size() const {
+                return this->_size;
+            }
+
+            // payload bytes held in memory (nothing in dummy mode or once spilled to a file)
+            size_t bufferedSize() const {
+                return this->_content.size();
+            }
+
+#ifdef __linux__
+            // Once the message grows over `threshold` bytes (0 disables) it is moved to a temporary
+            // file in `directory` (which must stay valid), and built as a file backed message
+            void setSpill(size_t threshold, const char* directory) {
+                this->_spillThreshold = threshold;
+                this->_spillDirectory = directory;
+            }
+
+            // the temporary file could not be created or written
+            bool isSpillFailed() const {
+                return this->_spillFailed;
+            }
+#endif
+
+            void setMaxSize(uint64_t maxSize) {
+                this->_maxSize = maxSize;
+            }
+
+            // true if `len` more bytes keep the message within the maximum size
+            bool fits(uint64_t len) const {
+                return this->_maxSize == 0 || (this->_size <= this->_maxSize && len <= this->_maxSize - this->_size);
+            }
             
             MessageType type() {
                 return this->_type;
             }
 
             WebsocketsMessage build() {
+#ifdef __linux__
+                if(this->_file) {
+                    std::shared_ptr<const internals::FileBuffer> file = std::move(this->_file);
+                    return WebsocketsMessage(this->_type, file, MessageRole::Complete);
+                }
+#endif
                 return WebsocketsMessage(
                     this->_type, 
                     std::move(this->_content),
@@ -169,18 +254,63 @@ namespace websockets {
             }
 
         private:
+            // flags and type first, so they share a word
             bool _dummyMode;
             bool _empty;
             bool _isComplete = false;
+            bool _didErrored = false;
+            MessageType _type = MessageType::Empty;
             WSString _content;
-            MessageType _type;
-            bool _didErrored;
+            uint64_t _size;
+            uint64_t _maxSize;
+#ifdef __linux__
+            size_t _spillThreshold = 0;
+            const char* _spillDirectory = nullptr;
+            bool _spillFailed = false;
+            std::shared_ptr<internals::FileBuffer> _file;
+
+            void spillFailed() {
+                this->_spillFailed = true;
+                this->_file.reset();
+                badFragment();
+            }
+#endif
+
+            void appendContent(const WSString& payload) {
+#ifdef __linux__
+                if(this->_file) {
+                    if(!this->_file->append(payload.data(), payload.size())) spillFailed();
+                    return;
+                }
+#endif
+                this->_content += payload;
+                spillIfNeeded();
+            }
+
+            void spillIfNeeded() {
+#ifdef __linux__
+                if(this->_spillThreshold == 0 || this->_content.size() <= this->_spillThreshold) return;
+
+                this->_file = std::make_shared<internals::FileBuffer>();
+                if(!this->_file->open(this->_spillDirectory) ||
+                   !this->_file->append(this->_content.data(), this->_content.size())) {
+                    spillFailed();
+                }
+                // give the memory back
+                WSString().swap(this->_content);
+#endif
+            }
         };
 
     private:
-        const MessageType _type;
-        const uint32_t _length;
-        const WSString _data;
-        const MessageRole _role;
+        // not const, so messages can be moved (there are no setters)
+        MessageType _type;
+        size_t _length;
+        WSString _data;
+        MessageRole _role;
+#ifdef __linux__
+        std::shared_ptr<const internals::FileBuffer> _file;
+        mutable WSString _fileCopy;
+#endif
     };
 }
\ No newline at end of file
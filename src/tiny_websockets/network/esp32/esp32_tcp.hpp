@@ -46,7 +46,8 @@ namespace websockets { namespace network {
     }
     
     TcpClient* accept() override {
-      while(available()) {
+      // don't spin waiting for a client, an unconnected client is returned instead
+      if(available() && server.hasClient()) {
         auto client = server.available();
         if(client) {
           return new Esp32TcpClient{client};
@@ -0,0 +1,80 @@
+#pragma once
+
+#if defined(__linux__) && !defined(_WS_CONFIG_NO_SSL)
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/linux/linux_tcp_client.hpp>
+
+#include <openssl/ssl.h>
+
+namespace websockets { namespace network {
+  // TLS over LinuxTcpClient using OpenSSL (link with -lssl -lcrypto).
+  // All the clients share a single SSL_CTX, and sessions are cached per host:port (and per CA / client
+  // certificate contents) so reconnecting (from any client) resumes the previous session instead of a full handshake.
+  // Peers are verified against the system's CA store unless `setCACert` or `setInsecure` is used
+  class SecuredLinuxTcpClient : public LinuxTcpClient {
+    public:
+        SecuredLinuxTcpClient();
+
+        bool connect(const WSString& host, int port) override;
+        bool beginConnect(const WSString& host, int port) override;
+        bool isConnecting() override;
+        bool poll() override;
+        bool available() override;
+        void send(const WSString& data) override;
+        void send(const WSString&& data) override;
+        void send(const uint8_t* data, const uint32_t len) override;
+        WSString readLine() override;
+        uint32_t read(uint8_t* buffer, const uint32_t len) override;
+        bool readAvailableUntil(WSString& data, const char* terminator, const size_t maxLen) override;
+        bool sendFile(int fd, uint64_t offset, uint64_t len) override;
+        void close() override;
+
+        // PEM strings, they must stay valid until the next connect
+        void setCACert(const char* ca_cert);
+        void setCertificate(const char* client_ca);
+        void setPrivateKey(const char* private_key);
+        void setInsecure();
+
+        // Asks OpenSSL to hand the negotiated keys to the kernel (kTLS) after the handshake. Records are
+        // then encrypted by the kernel: sends become plain socket writes and `sendFile` uses sendfile().
+        // Silently stays in user space when the kernel or the cipher doesn't support it
+        void setKernelTls(const bool enable);
+        // true when sending is offloaded to the kernel on the current connection
+        bool isKernelTlsActive() const;
+
+        // true if the last handshake resumed a cached session
+        bool isSessionReused() const;
+
+        virtual ~SecuredLinuxTcpClient();
+
+    private:
+        SSL* _ssl;
+        bool _handshaking;
+        WSString _host;
+        WSString _sessionKey;
+        const char* _caCert;
+        const char* _clientCert;
+        const char* _privateKey;
+        bool _insecure;
+        bool _sessionReused;
+        bool _kernelTls;
+        bool _kernelTx;
+
+        enum IoResult {
+            IoResult_Retry,
+            IoResult_TimedOut,
+            IoResult_Failed
+        };
+
+        void setSessionKey(const WSString& host, const int port);
+        bool startTls(const WSString& host);
+        // advances the handshake without blocking, true while it's still in progress
+        bool continueHandshake();
+        IoResult handleIoError(const int result);
+
+        friend int onNewSession(SSL* ssl, SSL_SESSION* session);
+  };
+}} // websockets::network
+
+#endif // #if defined(__linux__) && !defined(_WS_CONFIG_NO_SSL)
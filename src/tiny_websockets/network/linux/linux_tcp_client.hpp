@@ -2,32 +2,67 @@
 
 #ifdef __linux__ 
 
+#define INVALID_SOCKET -1
+
 #include <tiny_websockets/internals/ws_common.hpp>
 #include <tiny_websockets/network/tcp_client.hpp>
 #include <tiny_websockets/network/tcp_socket.hpp>
 
-#define INVALID_SOCKET -1
+#include <sys/socket.h>
+#include <netdb.h>
+#include <memory>
 
 namespace websockets { namespace network {
+  // `beginConnect` resolves host names it hasn't connected to before on a thread (link with -pthread on
+  // older glibc), `isConnecting` stays true while resolving so the caller's connect deadline covers it
   class LinuxTcpClient : public TcpClient {
     public:
         LinuxTcpClient(int socket = INVALID_SOCKET);
         bool connect(const WSString& host, int port) override;
+        bool beginConnect(const WSString& host, int port) override;
+        bool isConnecting() override;
         bool poll() override;
         bool available() override;
         void send(const WSString& data) override;
         void send(const WSString&& data) override;
         void send(const uint8_t* data, const uint32_t len) override;
         WSString readLine() override;
-        void read(uint8_t* buffer, const uint32_t len) override;
+        uint32_t read(uint8_t* buffer, const uint32_t len) override;
+        bool readAvailableUntil(WSString& data, const char* terminator, const size_t maxLen) override;
+        bool sendFile(int fd, uint64_t offset, uint64_t len) override;
         void close() override;
         virtual ~LinuxTcpClient();
 
     protected:
         virtual int getSocket() const override { return _socket; }
 
+        // waits (up to _CONNECTION_TIMEOUT) until the socket is ready for `events`
+        bool waitFor(short events);
+
+        bool openSocket(const WSString& host, int port, bool nonBlocking);
+        bool connectTo(const struct sockaddr* address, socklen_t addressLen, bool nonBlocking);
+        bool connectToAny(const struct addrinfo* addresses, const WSString& host, int port);
+        void rememberAddress(const struct addrinfo* address, const WSString& host, int port);
+        void startResolving(const WSString& host, int port);
+        bool connectNextAddress();
+
     private:
         int _socket;
+        bool _connecting;
+
+        // the address of the last successful connect, so reconnecting to the same host skips resolving it.
+        // Allocated by the first connect, accepted sockets never need it
+        struct CachedAddress {
+            WSString host;
+            int port;
+            struct sockaddr_storage address;
+            socklen_t addressLen;
+        };
+        std::unique_ptr<CachedAddress> _cachedAddress;
+
+        // the resolution an async connect is waiting for
+        struct Resolution;
+        std::shared_ptr<Resolution> _resolution;
     };
 }} // websockets::network
 
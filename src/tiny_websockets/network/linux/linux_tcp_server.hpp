@@ -5,13 +5,15 @@
 #include <tiny_websockets/internals/ws_common.hpp>
 #include <tiny_websockets/network/tcp_server.hpp>
 #include <tiny_websockets/network/linux/linux_tcp_client.hpp>
+#include <sys/socket.h>
+#include <deque>
 
-#define DEFAULT_BACKLOG_SIZE 5
+#define DEFAULT_BACKLOG_SIZE SOMAXCONN
 
 namespace websockets { namespace network {
   class LinuxTcpServer : public TcpServer {
     public:
-        LinuxTcpServer(size_t backlog = DEFAULT_BACKLOG_SIZE) : _num_backlog(backlog) {}
+        LinuxTcpServer(size_t backlog = DEFAULT_BACKLOG_SIZE) : _socket(INVALID_SOCKET), _num_backlog(backlog), _family(AF_INET) {}
         bool listen(const uint16_t port) override;
         bool poll() override;
         TcpClient* accept() override;
@@ -21,11 +23,20 @@ namespace websockets { namespace network {
 
     protected:
         virtual int getSocket() const override { return _socket; }
+
+        // opens the (non-blocking) listening socket and binds it to `address`
+        bool listenOn(const struct sockaddr* address, socklen_t addressLen);
     
     private:
         int _socket;
         size_t _num_backlog;
+        // address family of the listening socket, accepted TCP connections get TCP_NODELAY
+        int _family;
+        // connections accepted from the kernel's queue but not yet returned by `accept`
+        std::deque<int> _pending;
+
+        void acceptPending();
     };
 }} // websockets::network
 
-#endif // #ifdef __linux__ 
+#endif // #ifdef __linux__
@@ -0,0 +1,30 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/linux/linux_tcp_client.hpp>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace websockets { namespace network {
+  // Fills `address` for the unix socket at `path`. A leading '@' names a socket in Linux's
+  // abstract namespace (no file is involved). False if the path doesn't fit in sockaddr_un
+  bool unixSocketAddress(const WSString& path, struct sockaddr_un& address, socklen_t& addressLen);
+
+  // LinuxTcpClient over an AF_UNIX stream socket, for peers on the same machine.
+  // `host` is the path of the socket and `port` is ignored
+  class UnixSocketClient : public LinuxTcpClient {
+    public:
+        UnixSocketClient() {}
+
+        bool connect(const WSString& host, int port) override;
+        bool beginConnect(const WSString& host, int port) override;
+
+    private:
+        bool openUnixSocket(const WSString& path, bool nonBlocking);
+  };
+}} // websockets::network
+
+#endif // #ifdef __linux__
@@ -0,0 +1,27 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/linux/linux_tcp_server.hpp>
+#include <tiny_websockets/network/linux/linux_unix_socket_client.hpp>
+
+namespace websockets { namespace network {
+  // LinuxTcpServer listening on an AF_UNIX stream socket, `listen` ignores the port.
+  // A stale socket file (nobody listening on it) is replaced, and the file is removed on close
+  class UnixSocketServer : public LinuxTcpServer {
+    public:
+        UnixSocketServer(const WSString& path, size_t backlog = DEFAULT_BACKLOG_SIZE);
+
+        bool listen(const uint16_t port) override;
+        void close() override;
+        virtual ~UnixSocketServer();
+
+    private:
+        WSString _path;
+        // the socket file was created by this server
+        bool _bound;
+  };
+}} // websockets::network
+
+#endif // #ifdef __linux__
@@ -2,6 +2,7 @@
 
 #include <tiny_websockets/internals/ws_common.hpp>
 #include <tiny_websockets/network/tcp_socket.hpp>
+#include <string.h>
 
 namespace websockets { namespace network {
   struct TcpClient : public TcpSocket {
@@ -12,6 +13,30 @@ namespace websockets { namespace network {
     virtual WSString readLine() = 0;
     virtual uint32_t read(uint8_t* buffer, const uint32_t len) = 0;
     virtual bool connect(const WSString& host, int port) = 0;
+
+    // Starts connecting without waiting for the connection to be established, `isConnecting`
+    // is true until it either succeeds (`available` becomes true) or fails.
+    // Transports that can't connect asynchronously just connect (blocking) here
+    virtual bool beginConnect(const WSString& host, int port) { return connect(host, port); }
+    virtual bool isConnecting() { return false; }
+
+    // Sends `len` bytes of the file `fd` (starting at `offset`) without copying them through user space.
+    // Returns false if that failed (the connection is then closed), or, before sending anything,
+    // if the transport can't do that
+    virtual bool sendFile(int fd, uint64_t offset, uint64_t len) { (void) fd; (void) offset; (void) len; return false; }
+
+    // Appends to `data` what already arrived, without waiting for more and without reading past `terminator`
+    // (or past `maxLen` bytes in `data`). Returns true once `data` ends with `terminator`
+    virtual bool readAvailableUntil(WSString& data, const char* terminator, const size_t maxLen) {
+      const size_t terminatorLen = strlen(terminator);
+      while(data.size() < maxLen && available() && poll()) {
+        uint8_t ch;
+        if(read(&ch, 1) != 1) break;
+        data += static_cast<char>(ch);
+        if(data.size() >= terminatorLen && data.compare(data.size() - terminatorLen, terminatorLen, terminator) == 0) return true;
+      }
+      return false;
+    }
     virtual ~TcpClient() {}
   };
 }} // websockets::network
\ No newline at end of file
@@ -2,7 +2,16 @@
 
 #include <tiny_websockets/internals/ws_common.hpp>
 #include <tiny_websockets/client.hpp>
+#include <tiny_websockets/internals/timer_wheel.hpp>
+#include <tiny_websockets/internals/memory_budget.hpp>
+#include <tiny_websockets/internals/wscrypto/sha1.hpp>
 #include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+
+// clients built with _WS_CONFIG_CLIENT_ONLY always mask, they can't serve accepted connections
+#ifndef _WS_CONFIG_CLIENT_ONLY
 
 namespace websockets {
   class WebsocketsServer {
@@ -15,14 +24,95 @@ namespace websockets {
     WebsocketsServer& operator=(const WebsocketsServer& other) = delete;
     WebsocketsServer& operator=(const WebsocketsServer&& other) = delete;
 
+    // Extra headers are appended to every handshake response
+    void addHeader(const WSInterfaceString key, const WSInterfaceString value);
+
+    // Admission limits (0 means unlimited). Connections over the limits are rejected with a 503
+    void setMaxConnections(const size_t maxConnections);
+    void setMaxPendingHandshakes(const size_t maxPendingHandshakes);
+    // Connections whose upgrade request didn't arrive completely within `handshakeTimeoutMillis` are dropped
+    void setHandshakeTimeout(const unsigned long handshakeTimeoutMillis);
+
+    // Keep alive for accepted clients: a client that was silent for `pingIntervalMillis` is pinged,
+    // and closed if nothing arrives within `pongTimeoutMillis`. 0 disables pings
+    void setKeepAlive(const unsigned long pingIntervalMillis, const unsigned long pongTimeoutMillis);
+    // Closes accepted clients that didn't send any data message for `idleTimeoutMillis`. 0 disables
+    void setIdleTimeout(const unsigned long idleTimeoutMillis);
+    // Size limits given to every accepted client, see WebsocketsClient::setSizeLimits
+    void setSizeLimits(const size_t maxFrameSize, const size_t maxMessageSize, const size_t maxBufferedBytes = 0);
+
+    // Bytes received by all the clients accepted from now on (frames being read and fragments being
+    // aggregated) are counted against `limit`. Over it, reads from the largest consumers are paused until
+    // the total drops below `lowWatermark`, with `closeLargest` they are closed with CloseReason_MessageTooBig
+    void setMemoryBudget(const size_t limit, const size_t lowWatermark, const bool closeLargest = false);
+    size_t getMemoryUsage() const;
+
+    // Callbacks for every client accepted from now on. The clients share them instead of each holding a
+    // copy, a client's own `onMessage`/`onEvent` replaces them for that client only
+    void onMessage(const MessageCallback callback);
+    void onEvent(const EventCallback callback);
+
     bool available();
     void listen(uint16_t port);
     bool poll();
+    // Never waits for a request: requests are read as they arrive, over as many calls as it takes.
+    // Returns an unavailable client when no handshake is complete yet
     WebsocketsClient accept();
 
+    // Polls every client once (each within its own poll budget), starting from a different client
+    // on every call. Returns true if any of the clients has more work pending
+    bool pollClients(WebsocketsClient* clients, const size_t count);
+
     virtual ~WebsocketsServer();
 
   private:
     network::TcpServer* _server;
+    std::vector<std::pair<WSString, WSString>> _extraHeaders;
+    WSString _handshakeResponse;
+
+    size_t _nextClientToPoll;
+    size_t _maxConnections;
+    size_t _maxPendingHandshakes;
+    // accepted connections that were not upgraded yet, with what already arrived of their request
+    struct PendingHandshake {
+      std::shared_ptr<network::TcpClient> client;
+      WSString request;
+      unsigned long acceptedMillis;
+    };
+    std::deque<PendingHandshake> _pendingHandshakes;
+    unsigned long _handshakeTimeoutMillis;
+    // connections whose request was already validated and hashed, waiting for `accept` to answer them
+    struct PreparedHandshake {
+      std::shared_ptr<network::TcpClient> client;
+      char accept[SHA1_BASE64_SIZE];
+    };
+    std::deque<PreparedHandshake> _preparedHandshakes;
+    // upgraded connections, only tracked for counting against `_maxConnections`
+    std::vector<std::weak_ptr<network::TcpClient>> _connections;
+
+    // timers of accepted clients, only allocated once keep alive or idle timeout are set
+    std::unique_ptr<internals::TimerWheel> _timers;
+    unsigned long _pingIntervalMillis;
+    unsigned long _pongTimeoutMillis;
+    unsigned long _idleTimeoutMillis;
+    bool _hasSizeLimits;
+    size_t _maxFrameSize;
+    size_t _maxMessageSize;
+    size_t _maxBufferedBytes;
+    std::shared_ptr<internals::MemoryBudget> _memoryBudget;
+    std::shared_ptr<const WebsocketsClient::Callbacks> _clientCallbacks;
+
+    void enableTimers();
+    void handleTimers();
+    void scheduleKeepAlive(WebsocketsClient& client);
+    static void onKeepAliveTimer(internals::TimerNode& timer, void* server);
+
+    void buildHandshakeResponse();
+    void acceptPending();
+    void prepareHandshakes();
+    bool canAdmitConnection();
+    void pruneConnections();
   };
-}
\ No newline at end of file
+}
+
+#endif // #ifndef _WS_CONFIG_CLIENT_ONLY
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <tiny_websockets/internals/ws_common.hpp>
+#include <tiny_websockets/network/tcp_client.hpp>
+#include <tiny_websockets/internals/websockets_endpoint.hpp>
+#include <tiny_websockets/message.hpp>
+#include <tiny_websockets/client.hpp>
+
+namespace websockets {
+  // `data` is only valid during the call. Messages are null terminated (the terminator is not counted in `len`)
+  typedef void (*StaticMessageCallback)(void* context, MessageType type, const char* data, size_t len);
+  typedef void (*StaticEventCallback)(void* context, WebsocketsEvent event, const char* data, size_t len);
+
+  namespace internals {
+    // The size independent part of StaticWebsocketsClient, it works on buffers owned by the derived class.
+    // Nothing here allocates: no WSString, no std::function, no shared_ptr
+    class StaticWebsocketsEndpoint {
+    public:
+      // Upgrades `transport`, which must already be connected (resolving a host name allocates on most
+      // platforms, so it is left to the caller). The transport is not owned and must outlive the connection
+      bool connect(network::TcpClient& transport, const char* host, const char* path);
+
+      bool available();
+      // reads and dispatches every complete frame that is waiting, true if a message was delivered
+      bool poll();
+
+      bool send(const char* data, const size_t len);
+      bool sendBinary(const char* data, const size_t len);
+
+      bool ping(const char* data = nullptr, const size_t len = 0);
+      bool pong(const char* data = nullptr, const size_t len = 0);
+
+      void close(const CloseReason reason = CloseReason_NormalClosure);
+      CloseReason getCloseReason() const;
+
+      void onMessage(const StaticMessageCallback callback, void* context = nullptr);
+      void onEvent(const StaticEventCallback callback, void* context = nullptr);
+
+    protected:
+      StaticWebsocketsEndpoint(char* receiveBuffer, const size_t receiveCapacity,
+                               char* messageBuffer, const size_t maxMessageSize,
+                               char* sendBuffer, const size_t sendCapacity);
+
+      // the buffers belong to the derived class
+      StaticWebsocketsEndpoint(const StaticWebsocketsEndpoint&) = delete;
+      StaticWebsocketsEndpoint& operator=(const StaticWebsocketsEndpoint&) = delete;
+
+    private:
+      network::TcpClient* _transport;
+      bool _connectionOpen;
+      CloseReason _closeReason;
+
+      // handshake response and control frame payloads
+      char* _receiveBuffer;
+      size_t _receiveCapacity;
+      // fragments are aggregated here, one byte past `_maxMessageSize` is kept for the terminator
+      char* _messageBuffer;
+      size_t _maxMessageSize;
+      size_t _messageLength;
+      MessageType _messageType;
+      // handshake request and outgoing frames, longer payloads are masked and sent in chunks
+      char* _sendBuffer;
+      size_t _sendCapacity;
+
+      StaticMessageCallback _messageCallback;
+      void* _messageContext;
+      StaticEventCallback _eventCallback;
+      void* _eventContext;
+
+      bool readFrame();
+      bool sendFrame(const uint8_t opcode, const char* data, const size_t len);
+      void handleControlFrame(const uint8_t opcode, const size_t len);
+      void connectionLost();
+      void dispatchEvent(const WebsocketsEvent event, const char* data, const size_t len);
+    };
+  } // namespace internals
+
+  // A client that never touches the heap after construction (including the handshake), for targets
+  // where heap use after boot is not allowed. All buffers are members, sized at compile time:
+  //  - ReceiveCapacity: the handshake response headers (~256 bytes is plenty) and control frame payloads
+  //  - MaxMessageSize: the largest (aggregated) message, bigger ones close with CloseReason_MessageTooBig
+  //  - SendCapacity: the handshake request (~150 bytes plus host and path), then the frame header
+  //    and a chunk of the payload being masked
+  template <size_t ReceiveCapacity, size_t MaxMessageSize, size_t SendCapacity>
+  class StaticWebsocketsClient : public internals::StaticWebsocketsEndpoint {
+    static_assert(ReceiveCapacity >= 126, "control frames can carry up to 125 bytes (plus the terminator)");
+    static_assert(SendCapacity >= 128, "the send buffer must hold at least a handshake request");
+
+  public:
+    StaticWebsocketsClient() : internals::StaticWebsocketsEndpoint(
+        _receive, ReceiveCapacity, _message, MaxMessageSize, _send, SendCapacity) {
+      // Empty
+    }
+
+  private:
+    char _receive[ReceiveCapacity];
+    char _message[MaxMessageSize + 1];
+    char _send[SendCapacity];
+  };
+} // namespace websockets
@@ -1,5 +1,12 @@
 #pragma once
 
-#define _WS_CONFIG_NO_TRUE_RANDOMNESS
 #define _WS_BUFFER_SIZE 512
-#define _CONNECTION_TIMEOUT 1000
\ No newline at end of file
+#define _CONNECTION_TIMEOUT 1000
+
+// Payload buffers each connection keeps for reuse, and the largest size kept
+#ifndef _WS_BUFFER_POOL_SLOTS
+#define _WS_BUFFER_POOL_SLOTS 2
+#endif
+#ifndef _WS_BUFFER_POOL_MAX_SIZE
+#define _WS_BUFFER_POOL_MAX_SIZE (8 * _WS_BUFFER_SIZE)
+#endif
@@ -0,0 +1,261 @@
+#include <tiny_websockets/internals/utf8_validator.hpp>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  #define _WS_UTF8_SSSE3
+  #include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  #define _WS_UTF8_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace websockets { namespace internals {
+    // Length of the data that ends on a character boundary, `data` is already known to be valid
+    // except that its last character may be cut
+    static size_t boundaryBefore(const uint8_t* data, const size_t len) {
+        for(size_t back = 1; back <= 3 && back <= len; back++) {
+            const uint8_t byte = data[len - back];
+            if(byte < 0x80) return len;
+            if(byte >= 0xC0) {
+                const size_t needed = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+                return needed > back ? len - back : len;
+            }
+        }
+        return len;
+    }
+
+#if defined(_WS_UTF8_SSSE3) || defined(_WS_UTF8_NEON)
+    // The block algorithm classifies every byte by the high nibble of the previous byte, the low
+    // nibble of the previous byte and its own high nibble (three 16 entry lookups). A pair is invalid
+    // when the three classes share a bit. Continuations of 3 and 4 byte characters are checked
+    // separately, as in Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte"
+    enum Utf8Error : uint8_t {
+        Utf8Error_TooShort     = 1 << 0, // lead byte not followed by a continuation
+        Utf8Error_TooLong      = 1 << 1, // ascii followed by a continuation
+        Utf8Error_Overlong3    = 1 << 2,
+        Utf8Error_TooLarge     = 1 << 3, // above U+10FFFF
+        Utf8Error_Surrogate    = 1 << 4,
+        Utf8Error_Overlong2    = 1 << 5,
+        Utf8Error_TooLarge1000 = 1 << 6,
+        Utf8Error_Overlong4    = 1 << 6,
+        Utf8Error_TwoConts     = 1 << 7  // continuation after continuation (fine inside 3 and 4 byte characters)
+    };
+
+    #define CARRY (Utf8Error_TooShort | Utf8Error_TooLong | Utf8Error_TwoConts)
+
+    static const uint8_t FIRST_HIGH_NIBBLE[16] = {
+        Utf8Error_TooLong, Utf8Error_TooLong, Utf8Error_TooLong, Utf8Error_TooLong,
+        Utf8Error_TooLong, Utf8Error_TooLong, Utf8Error_TooLong, Utf8Error_TooLong,
+        Utf8Error_TwoConts, Utf8Error_TwoConts, Utf8Error_TwoConts, Utf8Error_TwoConts,
+        Utf8Error_TooShort | Utf8Error_Overlong2,
+        Utf8Error_TooShort,
+        Utf8Error_TooShort | Utf8Error_Overlong3 | Utf8Error_Surrogate,
+        Utf8Error_TooShort | Utf8Error_TooLarge | Utf8Error_TooLarge1000 | Utf8Error_Overlong4
+    };
+
+    static const uint8_t FIRST_LOW_NIBBLE[16] = {
+        CARRY | Utf8Error_Overlong3 | Utf8Error_Overlong2 | Utf8Error_Overlong4,
+        CARRY | Utf8Error_Overlong2,
+        CARRY,
+        CARRY,
+        CARRY | Utf8Error_TooLarge,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000 | Utf8Error_Surrogate,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000,
+        CARRY | Utf8Error_TooLarge | Utf8Error_TooLarge1000
+    };
+
+    static const uint8_t SECOND_HIGH_NIBBLE[16] = {
+        Utf8Error_TooShort, Utf8Error_TooShort, Utf8Error_TooShort, Utf8Error_TooShort,
+        Utf8Error_TooShort, Utf8Error_TooShort, Utf8Error_TooShort, Utf8Error_TooShort,
+        Utf8Error_TooLong | Utf8Error_Overlong2 | Utf8Error_TwoConts | Utf8Error_Overlong3 |
+            Utf8Error_TooLarge1000 | Utf8Error_Overlong4,
+        Utf8Error_TooLong | Utf8Error_Overlong2 | Utf8Error_TwoConts | Utf8Error_Overlong3 | Utf8Error_TooLarge,
+        Utf8Error_TooLong | Utf8Error_Overlong2 | Utf8Error_TwoConts | Utf8Error_Surrogate | Utf8Error_TooLarge,
+        Utf8Error_TooLong | Utf8Error_Overlong2 | Utf8Error_TwoConts | Utf8Error_Surrogate | Utf8Error_TooLarge,
+        Utf8Error_TooShort, Utf8Error_TooShort, Utf8Error_TooShort, Utf8Error_TooShort
+    };
+
+    #undef CARRY
+
+    // a block ending with any of these would be cut in the middle of a character
+    static const uint8_t INCOMPLETE_ABOVE[16] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF
+    };
+#endif
+
+#ifdef _WS_UTF8_SSSE3
+    #define SSSE3_TARGET __attribute__((target("ssse3")))
+
+    SSSE3_TARGET
+    static __m128i highNibbles(const __m128i value) {
+        return _mm_and_si128(_mm_srli_epi16(value, 4), _mm_set1_epi8(0x0F));
+    }
+
+    // Validates whole 16 byte blocks starting at a character boundary, `validated` is how much of
+    // it ends on a character boundary (the rest is left for the scalar code)
+    SSSE3_TARGET
+    static bool validateBlocksSsse3(const uint8_t* data, const size_t len, size_t& validated) {
+        const __m128i firstHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(FIRST_HIGH_NIBBLE));
+        const __m128i firstLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(FIRST_LOW_NIBBLE));
+        const __m128i secondHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SECOND_HIGH_NIBBLE));
+        const __m128i incompleteAbove = _mm_loadu_si128(reinterpret_cast<const __m128i*>(INCOMPLETE_ABOVE));
+
+        __m128i previous = _mm_setzero_si128();
+        __m128i previousIncomplete = _mm_setzero_si128();
+        __m128i errors = _mm_setzero_si128();
+
+        size_t done = 0;
+        for(; len - done >= 16; done += 16) {
+            const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + done));
+            if(_mm_movemask_epi8(input) == 0) {
+                // ascii only, valid unless the previous block left a character open
+                errors = _mm_or_si128(errors, previousIncomplete);
+            } else {
+                const __m128i previous1 = _mm_alignr_epi8(input, previous, 15);
+                const __m128i special = _mm_and_si128(
+                    _mm_and_si128(
+                        _mm_shuffle_epi8(firstHigh, highNibbles(previous1)),
+                        _mm_shuffle_epi8(firstLow, _mm_and_si128(previous1, _mm_set1_epi8(0x0F)))
+                    ),
+                    _mm_shuffle_epi8(secondHigh, highNibbles(input))
+                );
+
+                // the bytes 2 and 3 positions after a 3 or 4 byte lead must be continuations
+                const __m128i previous2 = _mm_alignr_epi8(input, previous, 14);
+                const __m128i previous3 = _mm_alignr_epi8(input, previous, 13);
+                const __m128i mustContinue = _mm_or_si128(
+                    _mm_subs_epu8(previous2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+                    _mm_subs_epu8(previous3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)))
+                );
+                const __m128i lengthErrors = _mm_and_si128(mustContinue, _mm_set1_epi8(static_cast<char>(0x80)));
+                errors = _mm_or_si128(errors, _mm_xor_si128(lengthErrors, special));
+            }
+
+            previousIncomplete = _mm_subs_epu8(input, incompleteAbove);
+            previous = input;
+        }
+
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(errors, _mm_setzero_si128())) != 0xFFFF) return false;
+        validated = boundaryBefore(data, done);
+        return true;
+    }
+
+    #undef SSSE3_TARGET
+
+    static bool hasSsse3() {
+        static const bool supported = __builtin_cpu_supports("ssse3");
+        return supported;
+    }
+#endif // _WS_UTF8_SSSE3
+
+#ifdef _WS_UTF8_NEON
+    static bool validateBlocksNeon(const uint8_t* data, const size_t len, size_t& validated) {
+        const uint8x16_t firstHigh = vld1q_u8(FIRST_HIGH_NIBBLE);
+        const uint8x16_t firstLow = vld1q_u8(FIRST_LOW_NIBBLE);
+        const uint8x16_t secondHigh = vld1q_u8(SECOND_HIGH_NIBBLE);
+        const uint8x16_t incompleteAbove = vld1q_u8(INCOMPLETE_ABOVE);
+
+        uint8x16_t previous = vdupq_n_u8(0);
+        uint8x16_t previousIncomplete = vdupq_n_u8(0);
+        uint8x16_t errors = vdupq_n_u8(0);
+
+        size_t done = 0;
+        for(; len - done >= 16; done += 16) {
+            const uint8x16_t input = vld1q_u8(data + done);
+            if(vmaxvq_u8(input) < 0x80) {
+                errors = vorrq_u8(errors, previousIncomplete);
+            } else {
+                const uint8x16_t previous1 = vextq_u8(previous, input, 15);
+                const uint8x16_t special = vandq_u8(
+                    vandq_u8(
+                        vqtbl1q_u8(firstHigh, vshrq_n_u8(previous1, 4)),
+                        vqtbl1q_u8(firstLow, vandq_u8(previous1, vdupq_n_u8(0x0F)))
+                    ),
+                    vqtbl1q_u8(secondHigh, vshrq_n_u8(input, 4))
+                );
+
+                const uint8x16_t previous2 = vextq_u8(previous, input, 14);
+                const uint8x16_t previous3 = vextq_u8(previous, input, 13);
+                const uint8x16_t mustContinue = vorrq_u8(
+                    vqsubq_u8(previous2, vdupq_n_u8(0xE0 - 0x80)),
+                    vqsubq_u8(previous3, vdupq_n_u8(0xF0 - 0x80))
+                );
+                errors = vorrq_u8(errors, veorq_u8(vandq_u8(mustContinue, vdupq_n_u8(0x80)), special));
+            }
+
+            previousIncomplete = vqsubq_u8(input, incompleteAbove);
+            previous = input;
+        }
+
+        if(vmaxvq_u8(errors) != 0) return false;
+        validated = boundaryBefore(data, done);
+        return true;
+    }
+#endif // _WS_UTF8_NEON
+
+    bool Utf8Validator::feed(const uint8_t* data, size_t len) {
+        // finish the character left open by the previous fragment
+        size_t done = len < this->_remaining ? len : this->_remaining;
+        if(!feedScalar(data, done)) return false;
+
+        size_t validated = 0;
+#if defined(_WS_UTF8_SSSE3)
+        if(hasSsse3() && !validateBlocksSsse3(data + done, len - done, validated)) return false;
+#elif defined(_WS_UTF8_NEON)
+        if(!validateBlocksNeon(data + done, len - done, validated)) return false;
+#endif
+        done += validated;
+
+        return feedScalar(data + done, len - done);
+    }
+
+    // Unicode table 3-7: the allowed range of the second byte depends on the lead byte
+    bool Utf8Validator::feedScalar(const uint8_t* data, size_t len) {
+        size_t i = 0;
+        while(i < len) {
+            if(this->_remaining == 0) {
+                // skip ascii a word at a time
+                while(len - i >= 8) {
+                    uint64_t word;
+                    memcpy(&word, data + i, 8);
+                    if(word & 0x8080808080808080ULL) break;
+                    i += 8;
+                }
+                if(i == len) break;
+
+                const uint8_t byte = data[i++];
+                if(byte < 0x80) continue;
+
+                this->_lower = 0x80;
+                this->_upper = 0xBF;
+                if(byte >= 0xC2 && byte <= 0xDF) {
+                    this->_remaining = 1;
+                } else if(byte >= 0xE0 && byte <= 0xEF) {
+                    this->_remaining = 2;
+                    if(byte == 0xE0) this->_lower = 0xA0; // overlong
+                    else if(byte == 0xED) this->_upper = 0x9F; // surrogates
+                } else if(byte >= 0xF0 && byte <= 0xF4) {
+                    this->_remaining = 3;
+                    if(byte == 0xF0) this->_lower = 0x90; // overlong
+                    else if(byte == 0xF4) this->_upper = 0x8F; // above U+10FFFF
+                } else {
+                    return false;
+                }
+            } else {
+                const uint8_t byte = data[i++];
+                if(byte < this->_lower || byte > this->_upper) return false;
+                this->_lower = 0x80;
+                this->_upper = 0xBF;
+                this->_remaining--;
+            }
+        }
+        return true;
+    }
+}} // websockets::internals
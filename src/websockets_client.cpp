@@ -2,6 +2,7 @@
 #include <tiny_websockets/network/tcp_client.hpp>
 #include <tiny_websockets/message.hpp>
 #include <tiny_websockets/client.hpp>
+#include <tiny_websockets/internals/handshake_parser.hpp>
 #include <tiny_websockets/internals/wscrypto/crypto.hpp>
 
 namespace websockets {
@@ -9,177 +10,259 @@ namespace websockets {
         // Empty
     }
 
+    struct WebsocketsClient::Outbound {
+        std::vector<std::pair<WSString, WSString>> customHeaders;
+        unsigned long connectTimeoutMillis = _CONNECTION_TIMEOUT;
+        unsigned long handshakeTimeoutMillis = _CONNECTION_TIMEOUT;
+
+        // last connect target, reused by reconnects
+        struct ConnectTarget {
+            WSString host;
+            int port = 0;
+            WSString path;
+        } target;
+        // prebuilt handshake request for `target`, only the key is replaced for every attempt
+        WSString handshakeTemplate;
+        size_t handshakeKeyOffset = 0;
+
+        struct Reconnect {
+            unsigned long minDelayMillis = 0;
+            unsigned long maxDelayMillis = 0;
+            unsigned long delayMillis = 0;
+            unsigned long scheduledAtMillis = 0;
+            unsigned long waitMillis = 0;
+            bool scheduled = false;
+            bool stopped = true;
+        } reconnect;
+
+        struct Standby {
+            std::unique_ptr<WebsocketsClient> client;
+            WSString url;
+            unsigned long keepAliveMillis = 0;
+            unsigned long lastPingMillis = 0;
+        } standby;
+
+    #ifdef ESP8266
+        const char* optional_ssl_fingerprint = nullptr;
+        const X509List* optional_ssl_trust_anchors = nullptr;
+        const PublicKey* optional_ssl_known_key = nullptr;
+        const X509List* optional_ssl_rsa_cert = nullptr;
+        const PrivateKey* optional_ssl_rsa_private_key = nullptr;
+        const X509List* optional_ssl_ec_cert = nullptr;
+        const PrivateKey* optional_ssl_ec_private_key = nullptr;
+    #elif defined(ESP32)
+        const char* optional_ssl_ca_cert = nullptr;
+        const char* optional_ssl_client_ca = nullptr;
+        const char* optional_ssl_private_key = nullptr;
+    #elif defined(__linux__)
+        const char* optional_ssl_ca_cert = nullptr;
+        const char* optional_ssl_client_ca = nullptr;
+        const char* optional_ssl_private_key = nullptr;
+        bool optional_ssl_insecure = false;
+        bool optional_ssl_kernel_tls = false;
+    #endif
+
+        // connections made on behalf of `other` (its standby) trust and present the same certificates
+        void copyTlsSettings(const Outbound& other) {
+        #ifdef ESP8266
+            this->optional_ssl_fingerprint = other.optional_ssl_fingerprint;
+            this->optional_ssl_trust_anchors = other.optional_ssl_trust_anchors;
+            this->optional_ssl_known_key = other.optional_ssl_known_key;
+            this->optional_ssl_rsa_cert = other.optional_ssl_rsa_cert;
+            this->optional_ssl_rsa_private_key = other.optional_ssl_rsa_private_key;
+            this->optional_ssl_ec_cert = other.optional_ssl_ec_cert;
+            this->optional_ssl_ec_private_key = other.optional_ssl_ec_private_key;
+        #elif defined(ESP32)
+            this->optional_ssl_ca_cert = other.optional_ssl_ca_cert;
+            this->optional_ssl_client_ca = other.optional_ssl_client_ca;
+            this->optional_ssl_private_key = other.optional_ssl_private_key;
+        #elif defined(__linux__)
+            this->optional_ssl_ca_cert = other.optional_ssl_ca_cert;
+            this->optional_ssl_client_ca = other.optional_ssl_client_ca;
+            this->optional_ssl_private_key = other.optional_ssl_private_key;
+            this->optional_ssl_insecure = other.optional_ssl_insecure;
+            this->optional_ssl_kernel_tls = other.optional_ssl_kernel_tls;
+        #else
+            (void) other;
+        #endif
+        }
+    };
+
+    WebsocketsClient::Outbound& WebsocketsClient::outbound() {
+        if(!this->_outbound) this->_outbound = std::unique_ptr<Outbound>(new Outbound);
+        return *this->_outbound;
+    }
+
+    // no-op callbacks, shared by every client that didn't set its own
+    std::shared_ptr<const WebsocketsClient::Callbacks> WebsocketsClient::defaultCallbacks() {
+        static const std::shared_ptr<const Callbacks> callbacks(new Callbacks{
+            [](WebsocketsClient&, WebsocketsMessage){},
+            [](WebsocketsClient&, WebsocketsEvent, WSInterfaceString){}
+        });
+        return callbacks;
+    }
+
     WebsocketsClient::WebsocketsClient(std::shared_ptr<network::TcpClient> client) :
         _client(client),
         _endpoint(client),
         _connectionOpen(client->available()),
-        _messagesCallback([](WebsocketsClient&, WebsocketsMessage){}),
-        _eventsCallback([](WebsocketsClient&, WebsocketsEvent, WSInterfaceString){}),
-        _sendMode(SendMode_Normal) {
+        _sendMode(SendMode_Normal),
+        _hasPendingWork(false),
+        _callbacks(defaultCallbacks()) {
         // Empty
     }
 
-    WebsocketsClient::WebsocketsClient(const WebsocketsClient& other) :
-        _client(other._client),
-        _endpoint(other._endpoint),
-        _connectionOpen(other._client->available()),
-        _messagesCallback(other._messagesCallback),
-        _eventsCallback(other._eventsCallback),
-        _sendMode(other._sendMode) {
-
-        // delete other's client
-        const_cast<WebsocketsClient&>(other)._client = nullptr;
-        const_cast<WebsocketsClient&>(other)._connectionOpen = false;
-    }
-
-    WebsocketsClient::WebsocketsClient(const WebsocketsClient&& other) :
-        _client(other._client),
-        _endpoint(other._endpoint),
-        _connectionOpen(other._client->available()),
-        _messagesCallback(other._messagesCallback),
-        _eventsCallback(other._eventsCallback),
-        _sendMode(other._sendMode) {
-
-        // delete other's client
-        const_cast<WebsocketsClient&>(other)._client = nullptr;
-        const_cast<WebsocketsClient&>(other)._connectionOpen = false;
+    WebsocketsClient::WebsocketsClient(WebsocketsClient&& other) noexcept :
+        _client(std::move(other._client)),
+        _endpoint(std::move(other._endpoint)),
+        _connectionOpen(other._connectionOpen),
+        _sendMode(other._sendMode),
+        _hasPendingWork(other._hasPendingWork),
+        _pollBudget(other._pollBudget),
+        _callbacks(std::move(other._callbacks)),
+        _pendingConnect(std::move(other._pendingConnect)),
+        _outbound(std::move(other._outbound)) {
+
+        takeKeepAlive(other);
+
+        other._connectionOpen = false;
+        other._hasPendingWork = false;
+        other._callbacks = defaultCallbacks();
     }
 
-    WebsocketsClient& WebsocketsClient::operator=(const WebsocketsClient& other) {
-        // call endpoint's copy operator
-        _endpoint = other._endpoint;
+    WebsocketsClient& WebsocketsClient::operator=(WebsocketsClient&& other) noexcept {
+        if(&other == this) return *this;
 
-        // get callbacks and data from other
-        this->_client = other._client;
-        this->_messagesCallback = other._messagesCallback;
-        this->_eventsCallback = other._eventsCallback;
+        this->_client = std::move(other._client);
+        this->_endpoint = std::move(other._endpoint);
         this->_connectionOpen = other._connectionOpen;
         this->_sendMode = other._sendMode;
+        this->_hasPendingWork = other._hasPendingWork;
+        this->_pollBudget = other._pollBudget;
+        this->_callbacks = std::move(other._callbacks);
+        this->_pendingConnect = std::move(other._pendingConnect);
+        this->_outbound = std::move(other._outbound);
+
+        takeKeepAlive(other);
 
-        // delete other's client
-        const_cast<WebsocketsClient&>(other)._client = nullptr;
-        const_cast<WebsocketsClient&>(other)._connectionOpen = false;
+        other._connectionOpen = false;
+        other._hasPendingWork = false;
+        other._callbacks = defaultCallbacks();
         return *this;
     }
 
-    WebsocketsClient& WebsocketsClient::operator=(const WebsocketsClient&& other) {
-        // call endpoint's copy operator
-        _endpoint = other._endpoint;
+    void WebsocketsClient::takeKeepAlive(WebsocketsClient& other) {
+        this->_keepAlive.delayMillis = other._keepAlive.delayMillis;
+        this->_keepAlive.idleMillis = other._keepAlive.idleMillis;
+        this->_keepAlive.gotMessage = other._keepAlive.gotMessage;
+        this->_keepAlive.gotData = other._keepAlive.gotData;
+        this->_keepAlive.awaitingPong = other._keepAlive.awaitingPong;
 
-        // get callbacks and data from other
-        this->_client = other._client;
-        this->_messagesCallback = other._messagesCallback;
-        this->_eventsCallback = other._eventsCallback;
-        this->_connectionOpen = other._connectionOpen;
-        this->_sendMode = other._sendMode;
-
-        // delete other's client
-        const_cast<WebsocketsClient&>(other)._client = nullptr;
-        const_cast<WebsocketsClient&>(other)._connectionOpen = false;
-        return *this;
+        // the timer is re-linked in place, it points back at its new owner
+        other._keepAlive.timer.transferTo(this->_keepAlive.timer);
+        this->_keepAlive.timer.context = this;
     }
 
-    struct HandshakeRequestResult {
-        WSString requestStr;
-        WSString expectedAcceptKey;
+    // 16 random bytes, base64 encoded
+    #define HANDSHAKE_KEY_SIZE 24
+
+    enum DefaultHeader {
+        DefaultHeader_Upgrade = 1 << 0,
+        DefaultHeader_Connection = 1 << 1,
+        DefaultHeader_Version = 1 << 2,
+        DefaultHeader_UserAgent = 1 << 3,
+        DefaultHeader_Origin = 1 << 4
     };
 
-    bool shouldAddDefaultHeader(const std::string& keyWord, const std::vector<std::pair<WSString, WSString>>& customHeaders) {
-        for (const auto& header : customHeaders) {
-            if(!keyWord.compare(header.first)) {
-                return false;
-            }
+    // Builds the whole request with a placeholder key and returns the offset of the key.
+    // The custom headers are scanned once, marking the default headers they override
+    size_t buildHandshakeTemplate(const WSString& host, const WSString& uri,
+                                  const std::vector<std::pair<WSString, WSString>>& customHeaders,
+                                  WSString& handshake) {
+        int overridden = 0;
+        size_t customHeadersSize = 0;
+        for (const auto& header: customHeaders) {
+            if(header.first == "Upgrade") overridden |= DefaultHeader_Upgrade;
+            else if(header.first == "Connection") overridden |= DefaultHeader_Connection;
+            else if(header.first == "Sec-WebSocket-Version") overridden |= DefaultHeader_Version;
+            else if(header.first == "User-Agent") overridden |= DefaultHeader_UserAgent;
+            else if(header.first == "Origin") overridden |= DefaultHeader_Origin;
+            customHeadersSize += header.first.size() + header.second.size() + 4;
         }
 
-        return true;
-    }
-
-    HandshakeRequestResult generateHandshake(const WSString& host, const WSString& uri,
-                                             const std::vector<std::pair<WSString, WSString>>& customHeaders) {
+        handshake.clear();
+        handshake.reserve(uri.size() + host.size() + customHeadersSize + 256);
 
-        WSString key = crypto::base64Encode(crypto::randomBytes(16));
-
-        WSString handshake = "GET " + uri + " HTTP/1.1\r\n";
-        handshake += "Host: " + host + "\r\n";
-        handshake += "Sec-WebSocket-Key: " + key + "\r\n";
+        handshake += "GET ";
+        handshake += uri;
+        handshake += " HTTP/1.1\r\nHost: ";
+        handshake += internals::handshakeHost(host.c_str());
+        handshake += "\r\nSec-WebSocket-Key: ";
+        const size_t keyOffset = handshake.size();
+        handshake.append(HANDSHAKE_KEY_SIZE, ' ');
+        handshake += "\r\n";
 
         for (const auto& header: customHeaders) {
-            handshake += header.first + ": " + header.second + "\r\n";
+            handshake += header.first;
+            handshake += ": ";
+            handshake += header.second;
+            handshake += "\r\n";
         }
 
-        if (shouldAddDefaultHeader("Upgrade", customHeaders)) {
+        if (!(overridden & DefaultHeader_Upgrade)) {
             handshake += "Upgrade: websocket\r\n";
         }
 
-        if (shouldAddDefaultHeader("Connection", customHeaders)) {
+        if (!(overridden & DefaultHeader_Connection)) {
             handshake += "Connection: Upgrade\r\n";
         }
 
-        if (shouldAddDefaultHeader("Sec-WebSocket-Version", customHeaders)) {
+        if (!(overridden & DefaultHeader_Version)) {
             handshake += "Sec-WebSocket-Version: 13\r\n";
         }
 
-        if (shouldAddDefaultHeader("User-Agent", customHeaders)) {
+        if (!(overridden & DefaultHeader_UserAgent)) {
             handshake += "User-Agent: TinyWebsockets Client\r\n";
         }
 
-        if (shouldAddDefaultHeader("Origin", customHeaders)) {
+        if (!(overridden & DefaultHeader_Origin)) {
             handshake += "Origin: https://github.com/gilmaimon/TinyWebsockets\r\n";
         }
 
         handshake += "\r\n";
-
-        HandshakeRequestResult result;
-        result.requestStr = handshake;
-#ifndef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
-        result.expectedAcceptKey = crypto::websocketsHandshakeEncodeKey(key);
-#endif
-        return result;
-    }
-
-    bool isWhitespace(char ch) {
-        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+        return keyOffset;
     }
 
-    struct HandshakeResponseResult {
-        bool isSuccess;
-        WSString serverAccept;
-    };
-
-    bool isCaseInsensetiveEqual(const WSString lhs, const WSString rhs) {
-      if (lhs.size() != rhs.size()) return false;
+    // Puts a fresh key into the handshake template (building it first if needed),
+    // returns the accept key the server is expected to answer with
+    WSString WebsocketsClient::prepareHandshake() {
+        auto& outbound = this->outbound();
+        if(outbound.handshakeTemplate.empty()) {
+            outbound.handshakeKeyOffset = buildHandshakeTemplate(
+                outbound.target.host, outbound.target.path, outbound.customHeaders, outbound.handshakeTemplate);
+        }
 
-      for (size_t i = 0; i < lhs.size(); i++) {
-        char leftLowerCaseChar = lhs[i] >= 'A' && lhs[i] <= 'Z' ? lhs[i] - 'A' + 'a' : lhs[i];
-        char righerLowerCaseChar = rhs[i] >= 'A' && rhs[i] <= 'Z' ? rhs[i] - 'A' + 'a' : rhs[i];
-        if (leftLowerCaseChar != righerLowerCaseChar) return false;
-      }
+        // the key is encoded straight into its slot in the template
+        uint8_t nonce[16];
+        crypto::randomFill(nonce, sizeof(nonce));
+        char* key = &outbound.handshakeTemplate[outbound.handshakeKeyOffset];
+        crypto::base64Encode(nonce, sizeof(nonce), key);
 
-      return true;
+#ifdef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
+        return "";
+#else
+        return crypto::websocketsHandshakeEncodeKey(key, HANDSHAKE_KEY_SIZE);
+#endif
     }
 
-    HandshakeResponseResult parseHandshakeResponse(std::vector<WSString> responseHeaders) {
-        bool didUpgradeToWebsockets = false, isConnectionUpgraded = false;
-        WSString serverAccept = "";
-        for(WSString header : responseHeaders) {
-            auto colonIndex = header.find_first_of(':');
-
-            WSString key = header.substr(0, colonIndex);
-            WSString value = header.substr(colonIndex + 2); // +2 (ignore space and ':')
-
-            if(isCaseInsensetiveEqual(key, "upgrade")) {
-                didUpgradeToWebsockets = isCaseInsensetiveEqual(value, "Websocket");
-            } else if(isCaseInsensetiveEqual(key, "connection")) {
-                isConnectionUpgraded = isCaseInsensetiveEqual(value, "upgrade");
-            } else if(isCaseInsensetiveEqual(key, "Sec-WebSocket-Accept")) {
-                serverAccept = value;
-            }
+    void WebsocketsClient::setTarget(const WSString& host, const int port, const WSString& path) {
+        auto& outbound = this->outbound();
+        if(host != outbound.target.host || path != outbound.target.path) {
+            outbound.target.host = host;
+            outbound.target.path = path;
+            outbound.handshakeTemplate.clear();
         }
-
-        HandshakeResponseResult result;
-        result.isSuccess = serverAccept != "" && didUpgradeToWebsockets && isConnectionUpgraded;
-        result.serverAccept = serverAccept;
-        return result;
+        outbound.target.port = port;
     }
 
     bool doestStartsWith(WSString str, WSString prefix) {
@@ -194,43 +277,57 @@ namespace websockets {
     void WebsocketsClient::upgradeToSecuredConnection() {
     #ifndef _WS_CONFIG_NO_SSL
         auto client = new WSDefaultSecuredTcpClient;
+        const auto& settings = outbound();
 
     #ifdef ESP8266
         if(
-				this->_optional_ssl_fingerprint
-			|| 	(this->_optional_ssl_rsa_cert && this->_optional_ssl_rsa_private_key)
-			|| 	(this->_optional_ssl_ec_cert && this->_optional_ssl_ec_private_key)
-			|| 	this->_optional_ssl_trust_anchors
-			|| 	this->_optional_ssl_known_key
+				settings.optional_ssl_fingerprint
+			|| 	(settings.optional_ssl_rsa_cert && settings.optional_ssl_rsa_private_key)
+			|| 	(settings.optional_ssl_ec_cert && settings.optional_ssl_ec_private_key)
+			|| 	settings.optional_ssl_trust_anchors
+			|| 	settings.optional_ssl_known_key
 		) {
-            if(this->_optional_ssl_fingerprint) {
-                client->setFingerprint(this->_optional_ssl_fingerprint);
+            if(settings.optional_ssl_fingerprint) {
+                client->setFingerprint(settings.optional_ssl_fingerprint);
             }
-            if(this->_optional_ssl_trust_anchors) {
-                client->setTrustAnchors(this->_optional_ssl_trust_anchors);
+            if(settings.optional_ssl_trust_anchors) {
+                client->setTrustAnchors(settings.optional_ssl_trust_anchors);
             }
-			if(this->_optional_ssl_known_key) {
-				client->setKnownKey(this->_optional_ssl_known_key);
+			if(settings.optional_ssl_known_key) {
+				client->setKnownKey(settings.optional_ssl_known_key);
 			}
-            if(this->_optional_ssl_rsa_cert && this->_optional_ssl_rsa_private_key) {
-                client->setClientRSACert(this->_optional_ssl_rsa_cert, this->_optional_ssl_rsa_private_key);
+            if(settings.optional_ssl_rsa_cert && settings.optional_ssl_rsa_private_key) {
+                client->setClientRSACert(settings.optional_ssl_rsa_cert, settings.optional_ssl_rsa_private_key);
             }
-			if(this->_optional_ssl_ec_cert && this->_optional_ssl_ec_private_key) {
-                client->setClientECCert(this->_optional_ssl_ec_cert, this->_optional_ssl_ec_private_key);
+			if(settings.optional_ssl_ec_cert && settings.optional_ssl_ec_private_key) {
+                client->setClientECCert(settings.optional_ssl_ec_cert, settings.optional_ssl_ec_private_key);
             }
         } else {
             client->setInsecure();
         }
     #elif defined(ESP32)
-        if(this->_optional_ssl_ca_cert) {
-            client->setCACert(this->_optional_ssl_ca_cert);
+        if(settings.optional_ssl_ca_cert) {
+            client->setCACert(settings.optional_ssl_ca_cert);
         }
-        if(this->_optional_ssl_client_ca) {
-            client->setCertificate(this->_optional_ssl_client_ca);
+        if(settings.optional_ssl_client_ca) {
+            client->setCertificate(settings.optional_ssl_client_ca);
         }
-        if(this->_optional_ssl_private_key) {
-            client->setPrivateKey(this->_optional_ssl_private_key);
+        if(settings.optional_ssl_private_key) {
+            client->setPrivateKey(settings.optional_ssl_private_key);
         }
+    #elif defined(__linux__)
+        if(settings.optional_ssl_insecure) {
+            client->setInsecure();
+        } else if(settings.optional_ssl_ca_cert) {
+            client->setCACert(settings.optional_ssl_ca_cert);
+        }
+        if(settings.optional_ssl_client_ca) {
+            client->setCertificate(settings.optional_ssl_client_ca);
+        }
+        if(settings.optional_ssl_private_key) {
+            client->setPrivateKey(settings.optional_ssl_private_key);
+        }
+        client->setKernelTls(settings.optional_ssl_kernel_tls);
     #endif
 
         this->_client = std::shared_ptr<WSDefaultSecuredTcpClient>(client);
@@ -238,38 +335,67 @@ namespace websockets {
     #endif //_WS_CONFIG_NO_SSL
     }
 
+    void WebsocketsClient::ensureTransport() {
+        if(this->_client) return;
+        this->_client = std::make_shared<WSDefaultTcpClient>();
+        this->_endpoint.setInternalSocket(this->_client);
+    }
+
+    void WebsocketsClient::useUnixSocket() {
+    #ifdef __linux__
+        this->_client = std::make_shared<network::UnixSocketClient>();
+        this->_endpoint.setInternalSocket(this->_client);
+    #endif
+    }
+
     void WebsocketsClient::addHeader(const WSInterfaceString key, const WSInterfaceString value) {
-        _customHeaders.push_back({internals::fromInterfaceString(key), internals::fromInterfaceString(value)});
+        auto& outbound = this->outbound();
+        outbound.customHeaders.push_back({internals::fromInterfaceString(key), internals::fromInterfaceString(value)});
+        outbound.handshakeTemplate.clear();
     }
 
-    bool WebsocketsClient::connect(WSInterfaceString _url) {
-        WSString url = internals::fromInterfaceString(_url);
-        WSString protocol = "";
+    struct ParsedUrl {
+        bool isSecure = false;
+        // `host` is the path of a unix socket
+        bool isUnix = false;
+        WSString host;
+        int port = 0;
+        WSString path;
+    };
+
+    bool parseUrl(WSString url, ParsedUrl& result) {
         int defaultPort = 0;
 
         if(doestStartsWith(url, "http://")) {
             defaultPort = 80;
-            protocol = "http";
             url = url.substr(7); //strlen("http://") == 7
         } else if(doestStartsWith(url, "ws://")) {
             defaultPort = 80;
-            protocol = "ws";
             url = url.substr(5); //strlen("ws://") == 5
         }
 
     #ifndef _WS_CONFIG_NO_SSL
         else if(doestStartsWith(url, "wss://")) {
             defaultPort = 443;
-            protocol = "wss";
+            result.isSecure = true;
             url = url.substr(6); //strlen("wss://") == 6
-
-            upgradeToSecuredConnection();
         } else if(doestStartsWith(url, "https://")) {
             defaultPort = 443;
-            protocol = "https";
+            result.isSecure = true;
             url = url.substr(8); //strlen("https://") == 8
+        }
+    #endif
 
-            upgradeToSecuredConnection();
+    #ifdef __linux__
+        else if(doestStartsWith(url, "ws+unix://")) {
+            // ws+unix://<socket path>[:<request path>], e.g. ws+unix:///run/app.sock:/chat
+            url = url.substr(10); //strlen("ws+unix://") == 10
+            auto pathBeg = url.find_first_of(':');
+            result.isUnix = true;
+            result.host = url.substr(0, pathBeg);
+            result.path = static_cast<int>(pathBeg) != -1 ? url.substr(pathBeg + 1) : "";
+            if(result.path.empty()) result.path = "/";
+            return !result.host.empty();
         }
     #endif
 
@@ -300,19 +426,51 @@ namespace websockets {
             host = onlyHost;
         }
 
+        result.host = host;
+        result.port = port;
+        result.path = uri;
+        return true;
+    }
+
+    // Checks a complete handshake response (status line and headers) against the request we sent
+    bool isValidHandshakeResponse(const WSString& response, const WSString& expectedAcceptKey) {
+        internals::HandshakeHeaders headers;
+        return internals::parseHandshakeHeaders(response.c_str(), response.size(), headers) &&
+               internals::isValidUpgradeResponse(headers, expectedAcceptKey.c_str());
+    }
+
+    bool WebsocketsClient::connect(WSInterfaceString _url) {
+        ParsedUrl url;
+        if(!parseUrl(internals::fromInterfaceString(_url), url)) return false;
+        if(url.isSecure) upgradeToSecuredConnection();
+        else if(url.isUnix) useUnixSocket();
+
         return this->connect(
-            internals::fromInternalString(host),
-            port,
-            internals::fromInternalString(uri)
+            internals::fromInternalString(url.host),
+            url.port,
+            internals::fromInternalString(url.path)
         );
     }
 
     bool WebsocketsClient::connect(WSInterfaceString host, int port, WSInterfaceString path) {
-        this->_connectionOpen = this->_client->connect(internals::fromInterfaceString(host), port);
+#ifdef _WS_CONFIG_SERVER_ONLY
+        // endpoints only speak the server side of the protocol
+        (void) host; (void) port; (void) path;
+        return false;
+#else
+        auto& outbound = this->outbound();
+        this->_pendingConnect.reset();
+        outbound.reconnect.stopped = false;
+        outbound.reconnect.scheduled = false;
+        setTarget(internals::fromInterfaceString(host), port, internals::fromInterfaceString(path));
+
+        ensureTransport();
+        this->_connectionOpen = this->_client->connect(outbound.target.host, outbound.target.port);
         if (!this->_connectionOpen) return false;
+        this->_endpoint.resetConnectionState();
 
-        auto handshake = generateHandshake(internals::fromInterfaceString(host), internals::fromInterfaceString(path), _customHeaders);
-        this->_client->send(handshake.requestStr);
+        WSString expectedAcceptKey = prepareHandshake();
+        this->_client->send(outbound.handshakeTemplate);
 
         // This check is needed because of an ESP32 lib bug that wont signal that the connection had
         // failed in `->connect` (called above), sometimes the disconnect will only be noticed here (after a `send`)
@@ -320,44 +478,234 @@ namespace websockets {
             return false;
         }
 
-        auto head = this->_client->readLine();
-        if(!doestStartsWith(head, "HTTP/1.1 101")) {
-            close(CloseReason_ProtocolError);
+        WSString response;
+        if(!internals::readHandshakeHeaders(*this->_client, response) ||
+           !isValidHandshakeResponse(response, expectedAcceptKey)) {
+            closeConnection(CloseReason_ProtocolError);
             return false;
         }
 
-        std::vector<WSString> serverResponseHeaders;
-        WSString line = "";
-        while (true) {
-            line = this->_client->readLine();
+        outbound.reconnect.delayMillis = outbound.reconnect.minDelayMillis;
+        this->_callbacks->events(*this, WebsocketsEvent::ConnectionOpened, {});
+        return true;
+#endif
+    }
 
-            if (line.size() < 2) {
-                close(CloseReason_ProtocolError);
-                return false;
-            }
+    struct WebsocketsClient::PendingConnect {
+        enum State {
+            State_Connecting,
+            State_HandshakeSent
+        } state;
+        unsigned long phaseStartMillis;
+        WSString response;
+        WSString expectedAcceptKey;
+    };
 
-            if (line == "\r\n") break;
-            // remove /r/n from line end
-            line = line.substr(0, line.size() - 2);
+    bool WebsocketsClient::connectAsync(WSInterfaceString _url) {
+        ParsedUrl url;
+        if(!parseUrl(internals::fromInterfaceString(_url), url)) return false;
+        if(url.isSecure) upgradeToSecuredConnection();
+        else if(url.isUnix) useUnixSocket();
 
-            serverResponseHeaders.push_back(line);
-        }
-        auto parsedResponse = parseHandshakeResponse(serverResponseHeaders);
+        return this->connectAsync(
+            internals::fromInternalString(url.host),
+            url.port,
+            internals::fromInternalString(url.path)
+        );
+    }
 
-#ifdef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
-        bool serverAcceptMismatch = false;
+    bool WebsocketsClient::connectAsync(WSInterfaceString host, int port, WSInterfaceString path) {
+        auto& outbound = this->outbound();
+        outbound.reconnect.stopped = false;
+        outbound.reconnect.scheduled = false;
+        setTarget(internals::fromInterfaceString(host), port, internals::fromInterfaceString(path));
+
+        return beginConnectAttempt();
+    }
+
+    bool WebsocketsClient::beginConnectAttempt() {
+#ifdef _WS_CONFIG_SERVER_ONLY
+        return false;
 #else
-        bool serverAcceptMismatch = parsedResponse.serverAccept != handshake.expectedAcceptKey;
+        auto& outbound = this->outbound();
+        this->_pendingConnect.reset();
+        this->_connectionOpen = false;
+
+        ensureTransport();
+        if(!this->_client->beginConnect(outbound.target.host, outbound.target.port)) return false;
+
+        this->_pendingConnect = std::unique_ptr<PendingConnect>(new PendingConnect);
+        this->_pendingConnect->state = PendingConnect::State_Connecting;
+        this->_pendingConnect->phaseStartMillis = millis();
+        advanceConnect();
+        return true;
 #endif
-        if(parsedResponse.isSuccess == false || serverAcceptMismatch) {
-            close(CloseReason_ProtocolError);
-            return false;
+    }
+
+    void WebsocketsClient::setAutoReconnect(const unsigned long minDelayMillis, const unsigned long maxDelayMillis) {
+        auto& outbound = this->outbound();
+        outbound.reconnect.minDelayMillis = minDelayMillis;
+        outbound.reconnect.maxDelayMillis = maxDelayMillis < minDelayMillis ? minDelayMillis : maxDelayMillis;
+        outbound.reconnect.delayMillis = minDelayMillis;
+        outbound.reconnect.scheduled = false;
+    }
+
+    // Exponential backoff with "equal jitter": waits between half and all of the current delay,
+    // so a fleet of clients dropped together doesn't come back at the same moment
+    void WebsocketsClient::scheduleReconnect() {
+        auto& outbound = this->outbound();
+        const unsigned long delay = outbound.reconnect.delayMillis;
+        outbound.reconnect.waitMillis = delay / 2 + crypto::randomNumber() % (delay - delay / 2 + 1);
+        outbound.reconnect.scheduledAtMillis = millis();
+        outbound.reconnect.scheduled = true;
+
+        const unsigned long nextDelay = delay * 2;
+        outbound.reconnect.delayMillis = nextDelay < outbound.reconnect.maxDelayMillis ? nextDelay : outbound.reconnect.maxDelayMillis;
+    }
+
+    void WebsocketsClient::setStandby(const WSInterfaceString url, const unsigned long keepAliveMillis) {
+        auto& outbound = this->outbound();
+        outbound.standby.client.reset();
+        outbound.standby.url = internals::fromInterfaceString(url);
+        outbound.standby.keepAliveMillis = keepAliveMillis;
+    }
+
+    void WebsocketsClient::pollStandby() {
+        if(!this->_outbound) return;
+        auto& outbound = *this->_outbound;
+        if(outbound.standby.url.empty()) return;
+
+        if(!outbound.standby.client) {
+            // a standby is only kept while the primary connection is up
+            if(!this->_connectionOpen) return;
+
+            auto standby = new WebsocketsClient;
+            standby->outbound().customHeaders = outbound.customHeaders;
+            standby->outbound().copyTlsSettings(outbound);
+            standby->setConnectTimeouts(outbound.connectTimeoutMillis, outbound.handshakeTimeoutMillis);
+            standby->setAutoReconnect(
+                outbound.reconnect.minDelayMillis != 0 ? outbound.reconnect.minDelayMillis : _CONNECTION_TIMEOUT,
+                outbound.reconnect.minDelayMillis != 0 ? outbound.reconnect.maxDelayMillis : 30000
+            );
+            outbound.standby.client.reset(standby);
+            outbound.standby.lastPingMillis = millis();
+            standby->connectAsync(internals::fromInternalString(outbound.standby.url));
+        }
+
+        auto& standby = *outbound.standby.client;
+        standby.poll();
+        if(standby.available() && millis() - outbound.standby.lastPingMillis >= outbound.standby.keepAliveMillis) {
+            standby.ping();
+            outbound.standby.lastPingMillis = millis();
         }
+    }
+
+    // Takes over the standby's (open) transport, the endpoint keeps its settings
+    bool WebsocketsClient::failoverToStandby() {
+        if(!this->_outbound) return false;
+        auto& outbound = *this->_outbound;
+        if(!outbound.standby.client || !outbound.standby.client->available()) return false;
 
-        this->_eventsCallback(*this, WebsocketsEvent::ConnectionOpened, {});
+        auto& standby = *outbound.standby.client;
+        this->_client = standby._client;
+        // also resets the endpoint: nothing of the dead connection (partial messages, close reason) carries over
+        this->_endpoint.setInternalSocket(this->_client);
+        this->_connectionOpen = true;
+        this->_sendMode = SendMode_Normal;
+
+        // detached before it's destroyed so the connection isn't closed, a new standby is started by `poll`
+        standby._client = nullptr;
+        standby._connectionOpen = false;
+        outbound.standby.client.reset();
         return true;
     }
 
+    void WebsocketsClient::reconnectIfDue() {
+        if(!this->_outbound) return;
+        auto& outbound = *this->_outbound;
+        if(outbound.reconnect.minDelayMillis == 0 || outbound.reconnect.stopped || !this->_client) return;
+
+        if(!outbound.reconnect.scheduled) {
+            scheduleReconnect();
+            return;
+        }
+        if(millis() - outbound.reconnect.scheduledAtMillis < outbound.reconnect.waitMillis) return;
+
+        outbound.reconnect.scheduled = false;
+        if(!beginConnectAttempt()) scheduleReconnect();
+    }
+
+    void WebsocketsClient::setConnectTimeouts(const unsigned long connectMillis, const unsigned long handshakeMillis) {
+        auto& outbound = this->outbound();
+        outbound.connectTimeoutMillis = connectMillis;
+        outbound.handshakeTimeoutMillis = handshakeMillis;
+    }
+
+    bool WebsocketsClient::isConnecting() const {
+        return this->_pendingConnect != nullptr;
+    }
+
+    // Moves a pending connect forward as far as it can go without blocking
+    void WebsocketsClient::advanceConnect() {
+        auto& outbound = *this->_outbound;
+        auto& pending = *this->_pendingConnect;
+
+        if(pending.state == PendingConnect::State_Connecting) {
+            if(this->_client->isConnecting()) {
+                if(millis() - pending.phaseStartMillis >= outbound.connectTimeoutMillis) {
+                    failConnect("connect timed out");
+                }
+                return;
+            }
+            if(!this->_client->available()) {
+                failConnect("connect failed");
+                return;
+            }
+
+            pending.expectedAcceptKey = prepareHandshake();
+            this->_client->send(outbound.handshakeTemplate);
+
+            pending.state = PendingConnect::State_HandshakeSent;
+            pending.phaseStartMillis = millis();
+            pending.response.reserve(_WS_BUFFER_SIZE);
+        }
+
+        // read only what already arrived, byte by byte so nothing past the headers is consumed
+        while(this->_client->available() && this->_client->poll()) {
+            uint8_t ch;
+            if(this->_client->read(&ch, 1) != 1) break;
+            pending.response += static_cast<char>(ch);
+
+            const size_t len = pending.response.size();
+            if(len >= 4 && ch == '\n' && pending.response.compare(len - 4, 4, "\r\n\r\n") == 0) {
+                if(!isValidHandshakeResponse(pending.response, pending.expectedAcceptKey)) {
+                    failConnect("invalid handshake response");
+                    return;
+                }
+
+                this->_pendingConnect.reset();
+                this->_connectionOpen = true;
+                this->_endpoint.resetConnectionState();
+                outbound.reconnect.delayMillis = outbound.reconnect.minDelayMillis;
+                this->_callbacks->events(*this, WebsocketsEvent::ConnectionOpened, {});
+                return;
+            }
+        }
+
+        if(!this->_client->available()) {
+            failConnect("connection closed during handshake");
+        } else if(millis() - pending.phaseStartMillis >= outbound.handshakeTimeoutMillis) {
+            failConnect("handshake timed out");
+        }
+    }
+
+    void WebsocketsClient::failConnect(const char* reason) {
+        this->_pendingConnect.reset();
+        this->_connectionOpen = false;
+        this->_client->close();
+        this->_callbacks->events(*this, WebsocketsEvent::ConnectionFailed, reason);
+    }
+
     bool WebsocketsClient::connectSecure(WSInterfaceString host, int port, WSInterfaceString path) {
         upgradeToSecuredConnection();
         
@@ -365,52 +713,92 @@ namespace websockets {
     }
 
     void WebsocketsClient::onMessage(MessageCallback callback) {
-        this->_messagesCallback = callback;
+        this->_callbacks = std::make_shared<const Callbacks>(Callbacks{callback, this->_callbacks->events});
     }
 
     void WebsocketsClient::onMessage(PartialMessageCallback callback) {
-        this->_messagesCallback = [callback](WebsocketsClient&, WebsocketsMessage msg) {
+        onMessage([callback](WebsocketsClient&, WebsocketsMessage msg) {
             callback(msg);
-        };
+        });
     }
 
     void WebsocketsClient::onEvent(EventCallback callback) {
-        this->_eventsCallback = callback;
+        this->_callbacks = std::make_shared<const Callbacks>(Callbacks{this->_callbacks->messages, callback});
     }
 
     void WebsocketsClient::onEvent(PartialEventCallback callback) {
-        this->_eventsCallback = [callback](WebsocketsClient&, WebsocketsEvent event, WSInterfaceString data) {
+        onEvent([callback](WebsocketsClient&, WebsocketsEvent event, WSInterfaceString data) {
             callback(event, data);
-        };
+        });
     }
 
     bool WebsocketsClient::poll() {
+        if(!this->_pendingConnect && !available()) {
+            reconnectIfDue();
+        }
+
+        if(this->_pendingConnect) {
+            advanceConnect();
+            if(this->_pendingConnect || !this->_connectionOpen) return false;
+        }
+
+        pollStandby();
+
         bool messageReceived = false;
+        size_t messagesCount = 0, bytesCount = 0;
+        const unsigned long startMillis = this->_pollBudget.maxMillis != 0 ? millis() : 0;
+
+        this->_hasPendingWork = false;
         while(available() && _endpoint.poll()) {
+            if((this->_pollBudget.maxMessages != 0 && messagesCount >= this->_pollBudget.maxMessages) ||
+               (this->_pollBudget.maxBytes != 0 && bytesCount >= this->_pollBudget.maxBytes) ||
+               (this->_pollBudget.maxMillis != 0 && millis() - startMillis >= this->_pollBudget.maxMillis)) {
+                // out of budget, the rest is left for the next call
+                this->_hasPendingWork = true;
+                break;
+            }
+
             auto msg = _endpoint.recv();
             if(msg.isEmpty()) {
                 continue;
             }
             messageReceived = true;
+            messagesCount++;
+            bytesCount += msg.length();
 
+            this->_keepAlive.gotMessage = true;
             if(msg.isBinary() || msg.isText()) {
-                this->_messagesCallback(*this, std::move(msg));
+                this->_keepAlive.gotData = true;
+            }
+
+            if(msg.isBinary() || msg.isText()) {
+                this->_callbacks->messages(*this, std::move(msg));
             } else if(msg.isContinuation()) {
                 // continuation messages will only be returned when policy is appropriate
-                this->_messagesCallback(*this, std::move(msg));
+                this->_callbacks->messages(*this, std::move(msg));
             } else if(msg.isPing()) {
                 _handlePing(std::move(msg));
             } else if(msg.isPong()) {
                 _handlePong(std::move(msg));
             } else if(msg.isClose()) {
                 this->_connectionOpen = false;
+                if(failoverToStandby()) continue;
                 _handleClose(std::move(msg));
             }
         }
 
+        this->_endpoint.settleMemory();
         return messageReceived;
     }
 
+    void WebsocketsClient::setPollBudget(const PollBudget& budget) {
+        this->_pollBudget = budget;
+    }
+
+    bool WebsocketsClient::hasPendingWork() const {
+        return this->_hasPendingWork;
+    }
+
     WebsocketsMessage WebsocketsClient::readBlocking() {
         while(available()) {
 #ifdef PLATFORM_DOES_NOT_SUPPORT_BLOCKING_READ
@@ -493,6 +881,15 @@ namespace websockets {
         return false;
     }
 
+#ifdef __linux__
+    bool WebsocketsClient::sendBinaryFile(int fd, const uint64_t len, const uint64_t offset) {
+        if(available() && this->_sendMode == SendMode_Normal) {
+            return _endpoint.sendFile(fd, offset, len, internals::ContentType::Binary, true);
+        }
+        return false;
+    }
+#endif
+
     bool WebsocketsClient::stream(const WSInterfaceString data) {
         if(available() && this->_sendMode == SendMode_Normal) {
             this->_sendMode = SendMode_Streaming;
@@ -534,6 +931,20 @@ namespace websockets {
         _endpoint.setFragmentsPolicy(newPolicy);
     }
 
+    void WebsocketsClient::setUtf8Validation(const bool validate) {
+        _endpoint.setUtf8Validation(validate);
+    }
+
+#ifdef __linux__
+    void WebsocketsClient::setMessageSpill(const size_t thresholdBytes, const char* directory) {
+        _endpoint.setMessageSpill(thresholdBytes, directory);
+    }
+#endif
+
+    void WebsocketsClient::setSizeLimits(const size_t maxFrameSize, const size_t maxMessageSize, const size_t maxBufferedBytes) {
+        _endpoint.setSizeLimits(maxFrameSize, maxMessageSize, maxBufferedBytes);
+    }
+
     bool WebsocketsClient::available(const bool activeTest) {
         if(activeTest)  {
             _endpoint.ping("");
@@ -542,8 +953,12 @@ namespace websockets {
         bool updatedConnectionOpen = this->_connectionOpen && this->_client && this->_client->available();
 
         if(updatedConnectionOpen != this->_connectionOpen) {
-            _endpoint.close(CloseReason_AbnormalClosure);
-            this->_eventsCallback(*this, WebsocketsEvent::ConnectionClosed, "");
+            // the reason is already set if the endpoint closed the connection itself (e.g. on invalid data)
+            if(_endpoint.getCloseReason() == CloseReason_None) {
+                _endpoint.close(CloseReason_AbnormalClosure);
+            }
+            if(failoverToStandby()) return true;
+            this->_callbacks->events(*this, WebsocketsEvent::ConnectionClosed, "");
         }
 
         this->_connectionOpen = updatedConnectionOpen;
@@ -565,6 +980,22 @@ namespace websockets {
     }
 
     void WebsocketsClient::close(const CloseReason reason) {
+        // an explicit close also stops auto reconnecting (until the next connect)
+        if(this->_outbound) {
+            this->_outbound->reconnect.stopped = true;
+            this->_outbound->standby.client.reset();
+        }
+        closeConnection(reason);
+    }
+
+    void WebsocketsClient::closeConnection(const CloseReason reason) {
+        if(this->_pendingConnect) {
+            // nothing was opened yet, just abort the attempt
+            this->_pendingConnect.reset();
+            this->_client->close();
+            return;
+        }
+
         if(available()) {
             this->_connectionOpen = false;
             _endpoint.close(reason);
@@ -577,72 +1008,101 @@ namespace websockets {
     }
 
     void WebsocketsClient::_handlePing(const WebsocketsMessage message) {
-        this->_eventsCallback(*this, WebsocketsEvent::GotPing, message.data());
+        this->_callbacks->events(*this, WebsocketsEvent::GotPing, message.data());
     }
 
     void WebsocketsClient::_handlePong(const WebsocketsMessage message) {
-        this->_eventsCallback(*this, WebsocketsEvent::GotPong, message.data());
+        this->_callbacks->events(*this, WebsocketsEvent::GotPong, message.data());
     }
 
     void WebsocketsClient::_handleClose(const WebsocketsMessage message) {
-        this->_eventsCallback(*this, WebsocketsEvent::ConnectionClosed, message.data());
+        this->_callbacks->events(*this, WebsocketsEvent::ConnectionClosed, message.data());
     }
 
 
 #ifdef ESP8266
     void WebsocketsClient::setFingerprint(const char* fingerprint) {
-        this->_optional_ssl_fingerprint = fingerprint;
+        this->outbound().optional_ssl_fingerprint = fingerprint;
     }
 
     void WebsocketsClient::setInsecure() {
-        this->_optional_ssl_fingerprint = nullptr;
-    	this->_optional_ssl_rsa_cert = nullptr;
-    	this->_optional_ssl_rsa_private_key = nullptr;
-		this->_optional_ssl_ec_cert = nullptr;
-    	this->_optional_ssl_ec_private_key = nullptr;
-    	this->_optional_ssl_trust_anchors = nullptr;
-		this->_optional_ssl_known_key = nullptr;
+        auto& outbound = this->outbound();
+        outbound.optional_ssl_fingerprint = nullptr;
+    	outbound.optional_ssl_rsa_cert = nullptr;
+    	outbound.optional_ssl_rsa_private_key = nullptr;
+		outbound.optional_ssl_ec_cert = nullptr;
+    	outbound.optional_ssl_ec_private_key = nullptr;
+    	outbound.optional_ssl_trust_anchors = nullptr;
+		outbound.optional_ssl_known_key = nullptr;
     }
 
     void WebsocketsClient::setClientRSACert(const X509List *cert, const PrivateKey *sk) {
-    	this->_optional_ssl_rsa_cert = cert;
-    	this->_optional_ssl_rsa_private_key = sk;
+        auto& outbound = this->outbound();
+    	outbound.optional_ssl_rsa_cert = cert;
+    	outbound.optional_ssl_rsa_private_key = sk;
 	}
 
 	void WebsocketsClient::setClientECCert(const X509List *cert, const PrivateKey *sk) {
-    	this->_optional_ssl_ec_cert = cert;
-    	this->_optional_ssl_ec_private_key = sk;
+        auto& outbound = this->outbound();
+    	outbound.optional_ssl_ec_cert = cert;
+    	outbound.optional_ssl_ec_private_key = sk;
 	}
 
     void WebsocketsClient::setTrustAnchors(const X509List *ta){
-    	this->_optional_ssl_trust_anchors = ta;
+    	this->outbound().optional_ssl_trust_anchors = ta;
 	}
 
 	void WebsocketsClient::setKnownKey(const PublicKey *pk) {
-		this->_optional_ssl_known_key = pk;
+		this->outbound().optional_ssl_known_key = pk;
 	}
 
 #elif defined(ESP32)
     void WebsocketsClient::setCACert(const char* ca_cert) {
-        this->_optional_ssl_ca_cert = ca_cert;
+        this->outbound().optional_ssl_ca_cert = ca_cert;
     }
 
     void WebsocketsClient::setCertificate(const char* client_ca) {
-        this->_optional_ssl_client_ca = client_ca;
+        this->outbound().optional_ssl_client_ca = client_ca;
     }
 
     void WebsocketsClient::setPrivateKey(const char* private_key) {
-        this->_optional_ssl_private_key = private_key;
+        this->outbound().optional_ssl_private_key = private_key;
     }
 
     void WebsocketsClient::setInsecure() {
-        this->_optional_ssl_ca_cert = nullptr;
-        this->_optional_ssl_client_ca = nullptr;
-        this->_optional_ssl_private_key = nullptr;
+        auto& outbound = this->outbound();
+        outbound.optional_ssl_ca_cert = nullptr;
+        outbound.optional_ssl_client_ca = nullptr;
+        outbound.optional_ssl_private_key = nullptr;
+    }
+#elif defined(__linux__)
+    void WebsocketsClient::setCACert(const char* ca_cert) {
+        auto& outbound = this->outbound();
+        outbound.optional_ssl_ca_cert = ca_cert;
+        outbound.optional_ssl_insecure = false;
+    }
+
+    void WebsocketsClient::setCertificate(const char* client_ca) {
+        this->outbound().optional_ssl_client_ca = client_ca;
+    }
+
+    void WebsocketsClient::setPrivateKey(const char* private_key) {
+        this->outbound().optional_ssl_private_key = private_key;
+    }
+
+    void WebsocketsClient::setInsecure() {
+        auto& outbound = this->outbound();
+        outbound.optional_ssl_ca_cert = nullptr;
+        outbound.optional_ssl_insecure = true;
+    }
+
+    void WebsocketsClient::setKernelTls(const bool enable) {
+        this->outbound().optional_ssl_kernel_tls = enable;
     }
 #endif
 
     WebsocketsClient::~WebsocketsClient() {
+        this->_keepAlive.timer.cancel();
         if(available()) {
             this->close(CloseReason_GoingAway);
         }
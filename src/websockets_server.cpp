@@ -1,10 +1,38 @@
 #include <tiny_websockets/server.hpp>
+#include <tiny_websockets/internals/handshake_parser.hpp>
 #include <tiny_websockets/internals/wscrypto/crypto.hpp>
+#include <tiny_websockets/internals/wscrypto/sha1.hpp>
 #include <memory>
-#include <map>
+
+#ifndef _WS_CONFIG_CLIENT_ONLY
 
 namespace websockets {
-    WebsocketsServer::WebsocketsServer(network::TcpServer* server) : _server(server) {}
+    WebsocketsServer::WebsocketsServer(network::TcpServer* server) : 
+        _server(server),
+        _nextClientToPoll(0),
+        _maxConnections(0),
+        _maxPendingHandshakes(0),
+        _handshakeTimeoutMillis(_CONNECTION_TIMEOUT),
+        _pingIntervalMillis(0),
+        _pongTimeoutMillis(0),
+        _idleTimeoutMillis(0),
+        _hasSizeLimits(false),
+        _maxFrameSize(0),
+        _maxMessageSize(0),
+        _maxBufferedBytes(0),
+        _clientCallbacks(WebsocketsClient::defaultCallbacks()) {
+        // Empty
+    }
+
+    void WebsocketsServer::onMessage(const MessageCallback callback) {
+        this->_clientCallbacks = std::make_shared<const WebsocketsClient::Callbacks>(
+            WebsocketsClient::Callbacks{callback, this->_clientCallbacks->events});
+    }
+
+    void WebsocketsServer::onEvent(const EventCallback callback) {
+        this->_clientCallbacks = std::make_shared<const WebsocketsClient::Callbacks>(
+            WebsocketsClient::Callbacks{this->_clientCallbacks->messages, callback});
+    }
 
     bool WebsocketsServer::available() {
         return this->_server->available();
@@ -15,79 +43,308 @@ namespace websockets {
     }
 
     bool WebsocketsServer::poll() {
-        return this->_server->poll();
+        handleTimers();
+        return !this->_pendingHandshakes.empty() || !this->_preparedHandshakes.empty() || this->_server->poll();
+    }
+
+    void WebsocketsServer::setKeepAlive(const unsigned long pingIntervalMillis, const unsigned long pongTimeoutMillis) {
+        this->_pingIntervalMillis = pingIntervalMillis;
+        this->_pongTimeoutMillis = pongTimeoutMillis;
+        enableTimers();
     }
 
-    struct ParsedHandshakeParams {
-        WSString head;
-        std::map<WSString, WSString> headers;
-    };
+    void WebsocketsServer::setIdleTimeout(const unsigned long idleTimeoutMillis) {
+        this->_idleTimeoutMillis = idleTimeoutMillis;
+        enableTimers();
+    }
+
+    void WebsocketsServer::setSizeLimits(const size_t maxFrameSize, const size_t maxMessageSize, const size_t maxBufferedBytes) {
+        this->_hasSizeLimits = true;
+        this->_maxFrameSize = maxFrameSize;
+        this->_maxMessageSize = maxMessageSize;
+        this->_maxBufferedBytes = maxBufferedBytes;
+    }
+
+    void WebsocketsServer::setMemoryBudget(const size_t limit, const size_t lowWatermark, const bool closeLargest) {
+        this->_memoryBudget = std::make_shared<internals::MemoryBudget>(limit, lowWatermark, closeLargest);
+    }
 
-    ParsedHandshakeParams recvHandshakeRequest(network::TcpClient& client) {
-        ParsedHandshakeParams result;
+    size_t WebsocketsServer::getMemoryUsage() const {
+        return this->_memoryBudget ? this->_memoryBudget->used() : 0;
+    }
 
-        result.head = client.readLine();
+    void WebsocketsServer::enableTimers() {
+        if(!this->_timers) {
+            this->_timers.reset(new internals::TimerWheel(millis()));
+        }
+    }
 
-        WSString line = client.readLine();
-        do {
-            WSString key = "", value = "";
-            size_t idx = 0;
+    void WebsocketsServer::handleTimers() {
+        if(this->_timers) {
+            this->_timers->advance(millis(), &WebsocketsServer::onKeepAliveTimer, this);
+        }
+    }
 
-            // read key
-            while(idx < line.size() && line[idx] != ':') {
-                key += line[idx];
-                idx++;
+    void WebsocketsServer::scheduleKeepAlive(WebsocketsClient& client) {
+        auto& keepAlive = client._keepAlive;
+        keepAlive.delayMillis = keepAlive.awaitingPong ? this->_pongTimeoutMillis : this->_pingIntervalMillis;
+        if(this->_idleTimeoutMillis != 0) {
+            const unsigned long remainingIdleMillis = this->_idleTimeoutMillis - keepAlive.idleMillis;
+            if(keepAlive.delayMillis == 0 || remainingIdleMillis < keepAlive.delayMillis) {
+                keepAlive.delayMillis = remainingIdleMillis;
             }
+        }
 
-            // skip key and whitespace
-            idx++;
-            while(idx < line.size() && (line[idx] == ' ' || line[idx] == '\t')) idx++;
+        keepAlive.gotMessage = false;
+        keepAlive.gotData = false;
+        keepAlive.timer.context = &client;
+        this->_timers->schedule(keepAlive.timer, keepAlive.delayMillis);
+    }
+
+    // Each client has a single timer, it fires when a ping is due, when the pong is late or when
+    // the client has been idle for too long. Activity in between only sets flags on the client
+    void WebsocketsServer::onKeepAliveTimer(internals::TimerNode& timer, void* arg) {
+        auto& server = *static_cast<WebsocketsServer*>(arg);
+        auto& client = *static_cast<WebsocketsClient*>(timer.context);
+        auto& keepAlive = client._keepAlive;
+        if(!client.available()) return;
+
+        keepAlive.idleMillis = keepAlive.gotData ? 0 : keepAlive.idleMillis + keepAlive.delayMillis;
+        if(!keepAlive.gotData) {
+            // no data for a whole period, the buffers kept for the next messages go back to the heap
+            client._endpoint.releaseBuffers();
+        }
+        if(server._idleTimeoutMillis != 0 && keepAlive.idleMillis >= server._idleTimeoutMillis) {
+            client.close(CloseReason_PolicyViolation);
+            return;
+        }
+
+        if(keepAlive.gotMessage) {
+            keepAlive.awaitingPong = false;
+        } else if(keepAlive.awaitingPong) {
+            // the peer is unresponsive
+            client.close(CloseReason_GoingAway);
+            return;
+        } else if(server._pingIntervalMillis != 0) {
+            keepAlive.awaitingPong = client.ping();
+        }
+
+        server.scheduleKeepAlive(client);
+    }
+
+    void WebsocketsServer::setMaxConnections(const size_t maxConnections) {
+        this->_maxConnections = maxConnections;
+    }
 
-            // read value (until \r\n)
-            while(idx < line.size() && line[idx] != '\r') {
-                value += line[idx];
-                idx++;
+    void WebsocketsServer::setMaxPendingHandshakes(const size_t maxPendingHandshakes) {
+        this->_maxPendingHandshakes = maxPendingHandshakes;
+    }
+
+    void WebsocketsServer::setHandshakeTimeout(const unsigned long handshakeTimeoutMillis) {
+        this->_handshakeTimeoutMillis = handshakeTimeoutMillis;
+    }
+
+    // forget connections that were closed (or dropped) by their owners
+    void WebsocketsServer::pruneConnections() {
+        size_t alive = 0;
+        for(size_t i = 0; i < this->_connections.size(); i++) {
+            auto connection = this->_connections[i].lock();
+            if(connection && connection->available()) {
+                this->_connections[alive++] = this->_connections[i];
             }
+        }
+        this->_connections.resize(alive);
+    }
 
-            // store header
-            result.headers[key] = value;
+    bool WebsocketsServer::canAdmitConnection() {
+        if(this->_maxPendingHandshakes != 0 && this->_pendingHandshakes.size() >= this->_maxPendingHandshakes) {
+            return false;
+        }
 
-            line = client.readLine();
-        } while(client.available() && line != "\r\n");
+        if(this->_maxConnections != 0 && this->_connections.size() + this->_pendingHandshakes.size() + this->_preparedHandshakes.size() >= this->_maxConnections) {
+            // only pay for pruning when the limit seems to be reached
+            pruneConnections();
+            return this->_connections.size() + this->_pendingHandshakes.size() + this->_preparedHandshakes.size() < this->_maxConnections;
+        }
 
-        return result;
+        return true;
+    }
+
+    static const char REJECTED_RESPONSE[] =
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Connection: close\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+
+    // Takes every connection that is already waiting, connections over the limits are
+    // rejected right away (without reading their request)
+    void WebsocketsServer::acceptPending() {
+        while(this->_server->poll()) {
+            std::shared_ptr<network::TcpClient> tcpClient(this->_server->accept());
+            if(tcpClient->available() == false) break;
+
+            if(canAdmitConnection()) {
+                this->_pendingHandshakes.push_back({tcpClient, {}, millis()});
+            } else {
+                tcpClient->send(reinterpret_cast<const uint8_t*>(REJECTED_RESPONSE), sizeof(REJECTED_RESPONSE) - 1);
+                tcpClient->close();
+            }
+        }
+    }
+
+    static const char HANDSHAKE_RESPONSE_PREFIX[] =
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Connection: Upgrade\r\n"
+        "Upgrade: websocket\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Accept: ";
+
+    // length of a base64 encoded sha1 digest
+    #define HANDSHAKE_ACCEPT_KEY_SIZE (SHA1_BASE64_SIZE - 1)
+
+    void WebsocketsServer::addHeader(const WSInterfaceString key, const WSInterfaceString value) {
+        this->_extraHeaders.push_back({internals::fromInterfaceString(key), internals::fromInterfaceString(value)});
+        this->_handshakeResponse.clear();
+    }
+
+    // Precomputes the constant parts of the response, only the accept key is filled in per client
+    void WebsocketsServer::buildHandshakeResponse() {
+        WSString& response = this->_handshakeResponse;
+        response = HANDSHAKE_RESPONSE_PREFIX;
+        response.append(HANDSHAKE_ACCEPT_KEY_SIZE, ' ');
+        response += "\r\n";
+        for(const auto& header : this->_extraHeaders) {
+            response += header.first + ": " + header.second + "\r\n";
+        }
+        response += "\r\n";
+    }
+
+    // how many handshakes are read and hashed together during an accept burst
+    #define HANDSHAKE_BATCH_SIZE 8
+    // requests reaching this size without ending are dropped, they can't be a reasonable upgrade request
+    #define HANDSHAKE_MAX_REQUEST_SIZE (8 * _WS_BUFFER_SIZE)
+
+    // Reads what already arrived of every pending request without waiting for the rest, so a slow (or
+    // malicious) client can't hold the server. Complete requests are validated and their accept keys
+    // are computed in one batch, requests that time out or grow too large are dropped
+    void WebsocketsServer::prepareHandshakes() {
+        WSString requests[HANDSHAKE_BATCH_SIZE];
+        std::shared_ptr<network::TcpClient> clients[HANDSHAKE_BATCH_SIZE];
+        const char* keys[HANDSHAKE_BATCH_SIZE];
+        size_t keyLens[HANDSHAKE_BATCH_SIZE];
+        size_t count = 0;
+
+        const unsigned long now = millis();
+        auto it = this->_pendingHandshakes.begin();
+        while(it != this->_pendingHandshakes.end() && count < HANDSHAKE_BATCH_SIZE) {
+            PendingHandshake& pending = *it;
+            if(pending.request.empty()) pending.request.reserve(_WS_BUFFER_SIZE);
+            const bool complete = pending.client->readAvailableUntil(pending.request, "\r\n\r\n", HANDSHAKE_MAX_REQUEST_SIZE);
+            if(!complete) {
+                const bool expired = now - pending.acceptedMillis >= this->_handshakeTimeoutMillis;
+                if(pending.client->available() && !expired && pending.request.size() < HANDSHAKE_MAX_REQUEST_SIZE) {
+                    ++it;
+                    continue;
+                }
+                it = this->_pendingHandshakes.erase(it);
+                continue;
+            }
+
+            std::shared_ptr<network::TcpClient> tcpClient = std::move(pending.client);
+            WSString& request = requests[count];
+            request = std::move(pending.request);
+            it = this->_pendingHandshakes.erase(it);
+
+            internals::HandshakeHeaders headers;
+            if(!internals::parseHandshakeHeaders(request.c_str(), request.size(), headers)) continue;
+
+            if(!headers.connection.containsTokenIgnoreCase("upgrade")) continue;
+            if(!headers.upgrade.equalsIgnoreCase("websocket")) continue;
+            if(!headers.secWebSocketVersion.equals("13")) continue;
+            if(headers.secWebSocketKey.empty()) continue;
+
+            clients[count] = tcpClient;
+            keys[count] = headers.secWebSocketKey.data;
+            keyLens[count] = headers.secWebSocketKey.size;
+            count++;
+        }
+        if(count == 0) return;
+
+        char accepts[HANDSHAKE_BATCH_SIZE][SHA1_BASE64_SIZE];
+        crypto::websocketsHandshakeEncodeKeys(keys, keyLens, accepts, count);
+        for(size_t i = 0; i < count; i++) {
+            this->_preparedHandshakes.push_back({clients[i], {}});
+            memcpy(this->_preparedHandshakes.back().accept, accepts[i], SHA1_BASE64_SIZE);
+        }
     }
 
     WebsocketsClient WebsocketsServer::accept() {
-        std::shared_ptr<network::TcpClient> tcpClient(_server->accept());
+        acceptPending();
+        if(this->_preparedHandshakes.empty()) prepareHandshakes();
+        if(this->_preparedHandshakes.empty()) return {};
+
+        PreparedHandshake prepared = this->_preparedHandshakes.front();
+        this->_preparedHandshakes.pop_front();
+        std::shared_ptr<network::TcpClient> tcpClient = prepared.client;
+        // it may have been dropped while waiting in the batch
         if(tcpClient->available() == false) return {};
-        
-        auto params = recvHandshakeRequest(*tcpClient);
-        
-        if(params.headers["Connection"].find("Upgrade") == std::string::npos) return {};
-        if(params.headers["Upgrade"] != "websocket") return {}; 
-        if(params.headers["Sec-WebSocket-Version"] != "13") return {}; 
-        if(params.headers["Sec-WebSocket-Key"] == "") return {};
-        
-        auto serverAccept = crypto::websocketsHandshakeEncodeKey(
-            params.headers["Sec-WebSocket-Key"]
-        );
 
-        tcpClient->send("HTTP/1.1 101 Switching Protocols\r\n");
-        tcpClient->send("Connection: Upgrade\r\n");
-        tcpClient->send("Upgrade: websocket\r\n");
-        tcpClient->send("Sec-WebSocket-Version: 13\r\n");
-        tcpClient->send("Sec-WebSocket-Accept: " + serverAccept + "\r\n");
-        tcpClient->send("\r\n");
+        // the whole response is sent with a single write (one segment, one TLS record)
+        if(this->_handshakeResponse.empty()) {
+            buildHandshakeResponse();
+        }
+        this->_handshakeResponse.replace(
+            sizeof(HANDSHAKE_RESPONSE_PREFIX) - 1,
+            HANDSHAKE_ACCEPT_KEY_SIZE,
+            prepared.accept,
+            HANDSHAKE_ACCEPT_KEY_SIZE
+        );
+        tcpClient->send(this->_handshakeResponse);
         
+        // connections are only tracked when there is a limit to enforce
+        if(this->_maxConnections != 0) {
+            this->_connections.push_back(tcpClient);
+        }
+
         WebsocketsClient wsClient(tcpClient);
-        // Don't use masking from server to client (according to RFC)
+        wsClient._callbacks = this->_clientCallbacks;
+        // Don't use masking from server to client, and expect masked frames from it (according to RFC)
+        wsClient._endpoint.setRole(internals::EndpointRole_Server);
         wsClient.setUseMasking(false);
+        if(this->_hasSizeLimits) {
+            wsClient.setSizeLimits(this->_maxFrameSize, this->_maxMessageSize, this->_maxBufferedBytes);
+        }
+        if(this->_memoryBudget) {
+            wsClient._endpoint.setMemoryAccount(std::make_shared<internals::MemoryAccount>(this->_memoryBudget));
+        }
+
+        if(this->_timers && (this->_pingIntervalMillis != 0 || this->_idleTimeoutMillis != 0)) {
+            scheduleKeepAlive(wsClient);
+        }
         return wsClient;
     }
 
+    bool WebsocketsServer::pollClients(WebsocketsClient* clients, const size_t count) {
+        handleTimers();
+        if(count == 0) return false;
+
+        bool hasPendingWork = false;
+        const size_t first = this->_nextClientToPoll % count;
+        for(size_t i = 0; i < count; i++) {
+            auto& client = clients[(first + i) % count];
+            client.poll();
+            hasPendingWork = hasPendingWork || client.hasPendingWork();
+        }
+
+        // rotate, so the same client doesn't always get served first
+        this->_nextClientToPoll = first + 1;
+        return hasPendingWork;
+    }
+
     WebsocketsServer::~WebsocketsServer() {
         this->_server->close();
     }
 
-} //websockets
\ No newline at end of file
+} //websockets
+
+#endif // #ifndef _WS_CONFIG_CLIENT_ONLY
@@ -1,5 +1,17 @@
 #include <tiny_websockets/internals/ws_common.hpp>
 
+#ifndef ARDUINO
+#include <time.h>
+
+namespace websockets {
+    unsigned long millis() {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<unsigned long>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+    }
+}
+#endif
+
 namespace websockets { namespace internals {
     WSString fromInterfaceString(const WSInterfaceString& str) {
         return str.c_str();